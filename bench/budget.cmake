@@ -0,0 +1,37 @@
+# keeps a benchmark render's dispatches under PASS_BUDGET ray-sphere tests,
+# included by the bench scripts
+#
+# every ray tests every sphere, so a dispatch over a large scene can run long
+# enough for the driver to reset the device. once pixels * samples per pass *
+# spheres exceeds PASS_BUDGET a pass takes a single sample and the image
+# shrinks until it fits
+
+# ray-sphere tests per pass for each bounce
+if(NOT PASS_BUDGET)
+  set(PASS_BUDGET 1000000000)
+endif()
+
+# lowers the variables named by width_var, height_var and samples_per_pass_var
+# in the caller's scope to fit a scene of the given number of spheres
+function(fit_pass_budget spheres width_var height_var samples_per_pass_var)
+  set(width ${${width_var}})
+  set(height ${${height_var}})
+  set(samples_per_pass ${${samples_per_pass_var}})
+  # divided rather than multiplied out, math() is only 64 bit since 3.13
+  math(EXPR max_samples "${PASS_BUDGET} / ${spheres}")
+  math(EXPR pass_samples "${width} * ${height} * ${samples_per_pass}")
+  if(pass_samples GREATER max_samples)
+    set(samples_per_pass 1)
+    while(width GREATER 1 AND height GREATER 1)
+      math(EXPR pass_samples "${width} * ${height}")
+      if(NOT pass_samples GREATER max_samples)
+        break()
+      endif()
+      math(EXPR width "${width} / 2")
+      math(EXPR height "${height} / 2")
+    endwhile()
+  endif()
+  set(${width_var} ${width} PARENT_SCOPE)
+  set(${height_var} ${height} PARENT_SCOPE)
+  set(${samples_per_pass_var} ${samples_per_pass} PARENT_SCOPE)
+endfunction()
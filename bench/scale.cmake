@@ -0,0 +1,68 @@
+# renders generated scenes of increasing size with traceg and collects the
+# per-stage timings (load, codegen, compile, upload, render) into one csv
+#
+# cmake -DSCENEGEN=<traceg-scenegen> -DTRACEG=<traceg> -DOUTPUT_DIR=<dir>
+#       [-DSIZES=10;100;...] [-DDISTRIBUTION=uniform] [-DYAML_LIMIT=100000]
+#       [-DPASS_BUDGET=1000000000] -P scale.cmake
+#
+# renders that would go over PASS_BUDGET (see budget.cmake) take a single
+# sample at a smaller size, so render times of large scenes are for fewer rays.
+# 10M spheres (-DSIZES=...;10000000) renders at 10x7, which leaves the gpu
+# mostly idle with each thread testing 10M spheres per bounce and can still
+# take seconds a pass, so the default sweep stops at 1M
+
+if(NOT SIZES)
+  set(SIZES 10 100 1000 10000 100000 1000000)
+endif()
+if(NOT DISTRIBUTION)
+  set(DISTRIBUTION uniform)
+endif()
+# yaml loading gets slow past this, larger scenes only use the binary format
+if(NOT YAML_LIMIT)
+  set(YAML_LIMIT 100000)
+endif()
+include("${CMAKE_CURRENT_LIST_DIR}/budget.cmake")
+
+set(STATS_FILE "${OUTPUT_DIR}/scale-${DISTRIBUTION}.csv")
+file(MAKE_DIRECTORY "${OUTPUT_DIR}")
+file(REMOVE "${STATS_FILE}")
+
+foreach(size IN LISTS SIZES)
+  set(scene "${OUTPUT_DIR}/${DISTRIBUTION}-${size}")
+  set(scene_files "${scene}.tgs")
+  if(size LESS_EQUAL YAML_LIMIT)
+    list(APPEND scene_files "${scene}.yaml")
+  endif()
+
+  execute_process(
+    COMMAND "${SCENEGEN}" --count ${size} --distribution ${DISTRIBUTION}
+            ${scene_files}
+    RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "scene generation failed for ${size} spheres")
+  endif()
+
+  set(width 320)
+  set(height 240)
+  set(samples 10)
+  set(samples_per_pass 10)
+  fit_pass_budget(${size} width height samples_per_pass)
+  # over budget renders take only one pass too, which can take seconds
+  if(samples_per_pass LESS samples)
+    set(samples ${samples_per_pass})
+  endif()
+
+  foreach(scene_file IN LISTS scene_files)
+    message(STATUS "rendering ${scene_file} at ${width}x${height}")
+    execute_process(
+      COMMAND "${TRACEG}" "${scene_file}" "${scene}.png"
+              --dims ${width}x${height} --samples ${samples}
+              --samples-per-pass ${samples_per_pass} --stats "${STATS_FILE}"
+      RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+      message(FATAL_ERROR "rendering ${scene_file} failed")
+    endif()
+  endforeach()
+endforeach()
+
+message(STATUS "timings written to ${STATS_FILE}")
@@ -0,0 +1,92 @@
+// measures build, binary load and codegen time and memory use of the
+// columnar scene store on a generated scene
+//
+// usage: scene-bench [SPHERE_COUNT] [uniform|clustered|nested]
+// (default 1000000 uniform)
+
+#include "procedural.hpp"
+#include "scene.hpp"
+#include "scene_binary.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+template <typename T> size_t column_bytes(const std::vector<T> &column) {
+  return column.capacity() * sizeof(T);
+}
+
+int main(int argc, char **argv) {
+  ProceduralSettings settings;
+  settings.count =
+      argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 1'000'000;
+  if (argc > 2) {
+    settings.distribution = distribution_from_name(argv[2]);
+  }
+  size_t count = settings.count;
+
+  auto start = std::chrono::steady_clock::now();
+  Scene scene = procedural_scene(settings);
+  Milliseconds build = std::chrono::steady_clock::now() - start;
+
+  // round trip through the binary scene format
+  auto scene_file =
+      (std::filesystem::temp_directory_path() / "scene-bench.tgs").string();
+  start = std::chrono::steady_clock::now();
+  save_scene_binary(scene_file, scene);
+  Milliseconds save = std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  scene = load_scene_binary(scene_file);
+  Milliseconds load = std::chrono::steady_clock::now() - start;
+  std::filesystem::remove(scene_file);
+
+  start = std::chrono::steady_clock::now();
+  auto source = scene.generate();
+  Milliseconds codegen = std::chrono::steady_clock::now() - start;
+
+  // stands in for the gpu upload, which is one memcpy per column into a
+  // mapped buffer
+  const auto &spheres = scene.spheres();
+  const auto &materials = scene.materials().materials();
+  start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> staging(
+      column_bytes(spheres.centers) + column_bytes(spheres.radii) +
+      column_bytes(spheres.materials) + column_bytes(materials));
+  uint8_t *cursor = staging.data();
+  auto copy_column = [&](const auto &column) {
+    size_t bytes = column.size() * sizeof(column[0]);
+    std::memcpy(cursor, column.data(), bytes);
+    cursor += bytes;
+  };
+  copy_column(spheres.centers);
+  copy_column(spheres.radii);
+  copy_column(spheres.materials);
+  copy_column(materials);
+  Milliseconds upload = std::chrono::steady_clock::now() - start;
+
+  size_t bytes = column_bytes(spheres.centers) + column_bytes(spheres.radii) +
+                 column_bytes(spheres.materials) + column_bytes(materials);
+
+  std::cout << "spheres:        " << spheres.size() << '\n'
+            << "materials:      " << materials.size() << '\n'
+            << "build:          " << build.count() << "ms\n"
+            << "save (.tgs):    " << save.count() << "ms\n"
+            << "load (.tgs):    " << load.count() << "ms\n"
+            << "codegen:        " << codegen.count() << "ms ("
+            << source.size() << " bytes)\n"
+            << "upload copy:    " << upload.count() << "ms\n"
+            << "scene memory:   " << bytes / (1024.0 * 1024.0) << "MiB\n"
+            << "bytes / sphere: "
+            << static_cast<double>(bytes) / static_cast<double>(count)
+            << '\n';
+
+  return EXIT_SUCCESS;
+}
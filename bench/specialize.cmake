@@ -0,0 +1,103 @@
+# renders single material and mixed material scenes with the specialized
+# shader variant and with every material compiled in, collecting the timings
+# into one csv and printing the specialized render time as a fraction of the
+# generic one for each scene
+#
+# cmake -DSCENEGEN=<traceg-scenegen> -DTRACEG=<traceg> -DOUTPUT_DIR=<dir>
+#       [-DCOUNT=10000] [-DPASS_BUDGET=1000000000] -P specialize.cmake
+#
+# the image is shrunk to keep each pass under PASS_BUDGET (see budget.cmake),
+# both variants of a scene always render at the same size
+
+if(NOT COUNT)
+  set(COUNT 10000)
+endif()
+include("${CMAKE_CURRENT_LIST_DIR}/budget.cmake")
+
+# render_ms from the csv in whole microseconds, math() only does integers
+function(ms_to_us value out)
+  if(NOT value MATCHES "^([0-9]+)(\\.([0-9]*))?$")
+    message(FATAL_ERROR "can't read render time ${value}")
+  endif()
+  set(fraction "${CMAKE_MATCH_3}000")
+  string(SUBSTRING "${fraction}" 0 3 fraction)
+  # the leading 1 keeps zeros at the start of the fraction from counting
+  math(EXPR us "${CMAKE_MATCH_1} * 1000 + 1${fraction} - 1000")
+  set(${out} ${us} PARENT_SCOPE)
+endfunction()
+
+set(STATS_FILE "${OUTPUT_DIR}/specialize.csv")
+file(MAKE_DIRECTORY "${OUTPUT_DIR}")
+file(REMOVE "${STATS_FILE}")
+
+set(width 640)
+set(height 480)
+set(samples_per_pass 10)
+fit_pass_budget(${COUNT} width height samples_per_pass)
+
+set(MIXES
+    "lambertian=1"
+    "metal=1"
+    "dielectric=1"
+    "lambertian=0.6,metal=0.3,dielectric=0.1")
+set(index 0)
+foreach(mix IN LISTS MIXES)
+  set(scene_file "${OUTPUT_DIR}/mix-${index}.tgs")
+  math(EXPR index "${index} + 1")
+  execute_process(
+    COMMAND "${SCENEGEN}" --count ${COUNT} --mix ${mix} "${scene_file}"
+    RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "scene generation failed for ${mix}")
+  endif()
+
+  foreach(variant_flag "" "--no-specialize")
+    message(STATUS "rendering ${mix} ${variant_flag} at ${width}x${height}")
+    execute_process(
+      COMMAND "${TRACEG}" "${scene_file}" "${OUTPUT_DIR}/render.png"
+              --dims ${width}x${height} --samples 50
+              --samples-per-pass ${samples_per_pass} --stats "${STATS_FILE}"
+              ${variant_flag}
+      RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+      message(FATAL_ERROR "rendering ${scene_file} failed")
+    endif()
+  endforeach()
+endforeach()
+
+message(STATUS "timings written to ${STATS_FILE}")
+
+# render times keyed by scene file and the specialized column
+file(STRINGS "${STATS_FILE}" rows)
+list(REMOVE_AT rows 0)
+foreach(row IN LISTS rows)
+  string(REPLACE "," ";" fields "${row}")
+  list(GET fields 0 scene_file)
+  list(GET fields 4 specialized)
+  list(GET fields -1 render_ms)
+  get_filename_component(name "${scene_file}" NAME_WE)
+  ms_to_us(${render_ms} render_us_${name}_${specialized})
+endforeach()
+
+set(index 0)
+foreach(mix IN LISTS MIXES)
+  set(specialized_us ${render_us_mix-${index}_1})
+  set(generic_us ${render_us_mix-${index}_0})
+  math(EXPR index "${index} + 1")
+  # keeps the multiply below from overflowing 32 bit math() before 3.13
+  while(specialized_us GREATER 20000000 OR generic_us GREATER 20000000)
+    math(EXPR specialized_us "${specialized_us} / 10")
+    math(EXPR generic_us "${generic_us} / 10")
+  endwhile()
+  if(NOT generic_us GREATER 0)
+    message(STATUS "${mix}: generic render too fast to compare")
+    continue()
+  endif()
+  math(EXPR percent "${specialized_us} * 100 / ${generic_us}")
+  math(EXPR whole "${percent} / 100")
+  math(EXPR fraction "${percent} % 100")
+  if(fraction LESS 10)
+    set(fraction "0${fraction}")
+  endif()
+  message(STATUS "${mix}: specialized / generic render_ms ${whole}.${fraction}")
+endforeach()
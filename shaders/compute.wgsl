@@ -1,9 +1,20 @@
+// running sum of every sample taken for each pixel, averaged by resolve.wgsl
 @group(0) @binding(0)
-var output_texture: texture_storage_2d<rgba8unorm, write>;
+var<storage, read_write> accumulation: array<vec4<f32>>;
 
 struct ConfigUniform {
+    // samples taken for each pixel by this pass
     samples_per_pixel: u32,
-    max_depth: u32
+    max_depth: u32,
+    // index of this pass, every pass gets an independent random stream so
+    // passes rendered separately (or resumed later) can be summed
+    pass_index: u32,
+    width: u32,
+    height: u32,
+    // primitives of each type, the scene buffers are padded so their
+    // arrayLength can be larger
+    sphere_count: u32,
+    plane_count: u32,
 };
 
 @group(1) @binding(0)
@@ -11,10 +22,22 @@ var<uniform> config: ConfigUniform;
 
 // xorshift rng
 var<private> s: u32;
-// seed with linear prng
-fn seed(id: u32) {
-    s = id * 1099087573;
-    // run one cycle so the first random number out isn't from lcg
+
+// pcg hash, used to spread out seeds from neighbouring pixels and passes
+fn hash_u32(x: u32) -> u32 {
+    let state = x * 747796405u + 2891336453u;
+    let word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+fn seed(id: u32, pass_index: u32) {
+    // mixed after hashing the id, with id ^ hash(pass) pixel a in pass p
+    // would share a stream with pixel a ^ hash(p) ^ hash(q) in pass q
+    s = hash_u32(hash_u32(id) ^ pass_index);
+    // xorshift gets stuck on zero
+    if s == 0u {
+        s = 1u;
+    }
     xorshift32();
 }
 
@@ -41,6 +64,23 @@ struct Sphere {
     radius: f32,
 }
 
+// scene arrays, uploaded straight from the columns of the host Scene. vec3s
+// are tightly packed on the host so they're read back as flat f32 arrays
+@group(2) @binding(0)
+var<storage, read> materials: array<Material>;
+@group(2) @binding(1)
+var<storage, read> sphere_centers: array<f32>;
+@group(2) @binding(2)
+var<storage, read> sphere_radii: array<f32>;
+@group(2) @binding(3)
+var<storage, read> sphere_materials: array<u32>;
+@group(2) @binding(4)
+var<storage, read> plane_points: array<f32>;
+@group(2) @binding(5)
+var<storage, read> plane_normals: array<f32>;
+@group(2) @binding(6)
+var<storage, read> plane_materials: array<u32>;
+
 struct Ray {
     origin: vec3<f32>,
     direction: vec3<f32>,
@@ -68,6 +108,16 @@ fn hitrecord_set_face_normal(record: ptr<function, HitRecord>, ray: Ray) {
     }
 }
 
+// the generated scene code defines HAS_<TYPE> for every primitive and
+// material type in the scene (see SceneFeatures), code for the rest is left
+// out by the preprocessor
+
+#ifdef HAS_SPHERES
+fn sphere_at(i: u32) -> Sphere {
+    let center = vec3<f32>(sphere_centers[3u * i], sphere_centers[3u * i + 1u], sphere_centers[3u * i + 2u]);
+    return Sphere(center, sphere_radii[i]);
+}
+
 // , record: HitRecord
 fn hit_sphere(sphere: Sphere, ray: Ray, tmin: f32, tmax: f32) -> HitRecord {
     var record: HitRecord;
@@ -100,12 +150,20 @@ fn hit_sphere(sphere: Sphere, ray: Ray, tmin: f32, tmax: f32) -> HitRecord {
     hitrecord_set_face_normal(&record, ray);
     return record;
 }
+#endif
 
 struct Plane {
     point: vec3<f32>,
     normal: vec3<f32>,
 }
 
+#ifdef HAS_PLANES
+fn plane_at(i: u32) -> Plane {
+    let point = vec3<f32>(plane_points[3u * i], plane_points[3u * i + 1u], plane_points[3u * i + 2u]);
+    let normal = vec3<f32>(plane_normals[3u * i], plane_normals[3u * i + 1u], plane_normals[3u * i + 2u]);
+    return Plane(point, normal);
+}
+
 fn hit_plane(plane: Plane, ray: Ray, tmin: f32, tmax: f32) -> HitRecord {
     var record: HitRecord;
     record.hit = false;
@@ -126,6 +184,7 @@ fn hit_plane(plane: Plane, ray: Ray, tmin: f32, tmax: f32) -> HitRecord {
 
     return record;
 }
+#endif
 
 const U32_MAX: u32 = 4294967295;
 
@@ -161,6 +220,82 @@ fn reflectance(cosine: f32, ref_idx: f32) -> f32 {
     return r0 + (1.0 - r0) * pow(1.0 - cosine, 5.0);
 }
 
+#ifdef HAS_LAMBERTIAN
+fn scatter_lambertian(record: HitRecord) -> Ray {
+    let direction = record.normal + random_vec3_normalized();
+    return Ray(record.point, direction);
+}
+#endif
+
+#ifdef HAS_METAL
+fn scatter_metal(record: HitRecord, ray: Ray) -> Ray {
+    let reflected = reflect(normalize(ray.direction), record.normal);
+    return Ray(record.point, reflected + record.material.data.w * random_vec3_normalized());
+}
+#endif
+
+#ifdef HAS_DIELECTRIC
+fn scatter_dielectric(record: HitRecord, ray: Ray) -> Ray {
+    var refraction_ratio: f32;
+    if record.front_face {
+        refraction_ratio = 1.0 / record.material.data.w;
+    } else {
+        refraction_ratio = record.material.data.w;
+    }
+
+    let unit_dir = normalize(ray.direction);
+    let cos_theta = min(dot(-unit_dir, record.normal), 1.0);
+    let sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+
+    let cannot_refract = refraction_ratio * sin_theta > 1.0;
+
+    var direction: vec3<f32>;
+    if cannot_refract || reflectance(cos_theta, refraction_ratio) > random_f32() {
+        direction = reflect(unit_dir, record.normal);
+    } else {
+        direction = refract(unit_dir, record.normal, refraction_ratio);
+    }
+    return Ray(record.point, direction);
+}
+#endif
+
+fn scatter(record: HitRecord, ray: Ray) -> Ray {
+#ifdef SINGLE_MATERIAL
+    // every hit has the same material type, no need to branch on it
+#ifdef HAS_LAMBERTIAN
+    return scatter_lambertian(record);
+#endif
+#ifdef HAS_METAL
+    return scatter_metal(record, ray);
+#endif
+#ifdef HAS_DIELECTRIC
+    return scatter_dielectric(record, ray);
+#endif
+#else
+    switch record.material.type_ {
+#ifdef HAS_METAL
+        case MATERIAL_METAL: {
+            return scatter_metal(record, ray);
+        }
+#endif
+#ifdef HAS_DIELECTRIC
+        case MATERIAL_DIELECTRIC: {
+            return scatter_dielectric(record, ray);
+        }
+#endif
+        default: {
+#ifdef HAS_LAMBERTIAN
+            return scatter_lambertian(record);
+#else
+            // only reachable in scenes without any materials, i.e. nothing
+            // to hit
+            return ray;
+#endif
+        }
+    }
+#endif
+}
+
 const RAY_MAX: f32 = 1e30;
 fn ray_color(ray: Ray) -> vec3<f32> {
     let unit_dir = normalize(ray.direction);
@@ -170,38 +305,7 @@ fn ray_color(ray: Ray) -> vec3<f32> {
     var record = hit_scene(cur_ray, 0.001, RAY_MAX);
     for (var i: u32 = 0; record.hit && i < config.max_depth; i++) {
         color = record.material.data.xyz * color;
-        switch record.material.type_ {
-            case MATERIAL_LAMBERTIAN, default: {
-                let direction = record.normal + random_vec3_normalized();
-                cur_ray = Ray(record.point, direction);
-            }
-            case MATERIAL_METAL: {
-                let reflected = reflect(normalize(cur_ray.direction), record.normal);
-                cur_ray = Ray(record.point, reflected + record.material.data.w * random_vec3_normalized());
-            }
-            case MATERIAL_DIELECTRIC: {
-                var refraction_ratio: f32;
-                if record.front_face {
-                    refraction_ratio = 1.0 / record.material.data.w;
-                } else {
-                    refraction_ratio = record.material.data.w;
-                }
-
-                let unit_dir = normalize(cur_ray.direction);
-                let cos_theta = min(dot(-unit_dir, record.normal), 1.0);
-                let sin_theta = sqrt(1.0 - cos_theta * cos_theta);
-
-                let cannot_refract = refraction_ratio * sin_theta > 1.0;
-
-                var direction: vec3<f32>;
-                if cannot_refract || reflectance(cos_theta, refraction_ratio) > random_f32() {
-                    direction = reflect(unit_dir, record.normal);
-                } else {
-                    direction = refract(unit_dir, record.normal, refraction_ratio);
-                }
-                cur_ray = Ray(record.point, direction);
-            }
-        }
+        cur_ray = scatter(record, cur_ray);
         record = hit_scene(cur_ray, 0.001, RAY_MAX);
     }
 
@@ -214,7 +318,7 @@ fn random_uv_noise() -> vec2<f32> {
 
 @compute @workgroup_size(16, 16)
 fn main(@builtin(global_invocation_id) global_id: vec3<u32>) {
-    let dims = textureDimensions(output_texture);
+    let dims = vec2<u32>(config.width, config.height);
     let coords = vec2<u32>(global_id.xy);
 
     // check out of bounds on texture
@@ -225,7 +329,7 @@ fn main(@builtin(global_invocation_id) global_id: vec3<u32>) {
     // seed rng
     // unique id of the thread
     let uid = dims.x * coords.y + coords.x;
-    seed(uid);
+    seed(uid, config.pass_index);
 
     let aspect = f32(dims.y) / f32(dims.x);
     let focal_length = 0.5;
@@ -244,6 +348,5 @@ fn main(@builtin(global_invocation_id) global_id: vec3<u32>) {
         color += ray_color(ray);
     }
 
-    textureStore(output_texture, coords.xy,
-                 vec4<f32>(color / f32(config.samples_per_pixel), 1.0));
+    accumulation[uid] += vec4<f32>(color, 0.0);
 }
@@ -0,0 +1,149 @@
+// averages the accumulated samples of compute.wgsl, post processes them and
+// packs them tightly in the output format, so readback is only as large as
+// the image being written. src/post.cpp is the cpu version of this pass
+
+@group(0) @binding(0)
+var<storage, read> accumulation: array<vec4<f32>>;
+
+// tightly packed pixels, see the FORMAT_* constants for the layouts
+@group(0) @binding(1)
+var<storage, read_write> output: array<u32>;
+
+// must match PixelFormat in output.hpp
+// 4 pixels per invocation packed into 3 words
+const FORMAT_RGB8: u32 = 0u;
+// two words per pixel, linear
+const FORMAT_RGBA16F: u32 = 1u;
+// three words per pixel, linear
+const FORMAT_RGB32F: u32 = 2u;
+
+// must match Tonemap in post.hpp
+const TONEMAP_NONE: u32 = 0u;
+const TONEMAP_REINHARD: u32 = 1u;
+const TONEMAP_ACES: u32 = 2u;
+
+const WORKGROUP_SIZE: u32 = 256u;
+
+struct ResolveUniform {
+    width: u32,
+    height: u32,
+    samples: f32,
+    // linear scale, 2^stops
+    exposure: f32,
+    tonemap: u32,
+    srgb: u32,
+    dither: u32,
+    format: u32,
+};
+
+@group(0) @binding(2)
+var<uniform> resolve: ResolveUniform;
+
+// https://www.reedbeta.com/blog/hash-functions-for-gpu-rendering/
+fn hash_u32(input: u32) -> u32 {
+    let state = input * 747796405u + 2891336453u;
+    let word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+fn linear_color(index: u32) -> vec3<f32> {
+    var color = vec3<f32>(0.0);
+    if resolve.samples > 0.0 {
+        color = accumulation[index].rgb / resolve.samples;
+    }
+    return color * resolve.exposure;
+}
+
+fn tonemap(color: vec3<f32>) -> vec3<f32> {
+    switch resolve.tonemap {
+        case TONEMAP_REINHARD: {
+            return color / (1.0 + color);
+        }
+        case TONEMAP_ACES: {
+            // Narkowicz's fit of the ACES filmic curve
+            return clamp((color * (2.51 * color + 0.03)) /
+                         (color * (2.43 * color + 0.59) + 0.14),
+                         vec3<f32>(0.0), vec3<f32>(1.0));
+        }
+        default: {
+            return color;
+        }
+    }
+}
+
+fn srgb_encode(color: vec3<f32>) -> vec3<f32> {
+    let c = clamp(color, vec3<f32>(0.0), vec3<f32>(1.0));
+    return select(1.055 * pow(c, vec3<f32>(1.0 / 2.4)) - 0.055, 12.92 * c,
+                  c <= vec3<f32>(0.0031308));
+}
+
+// display referred color for the 8 bit format
+fn display_color(index: u32) -> vec3<f32> {
+    var color = tonemap(linear_color(index));
+    if resolve.srgb != 0u {
+        color = srgb_encode(color);
+    }
+    if resolve.dither != 0u {
+        let hash = hash_u32(index);
+        let noise = f32(hash & 0xffffu) / 65536.0 - f32(hash >> 16u) / 65536.0;
+        color += vec3<f32>(noise / 255.0);
+    }
+    return color;
+}
+
+// same rounding as pack4x8unorm
+fn to_unorm(color: vec3<f32>) -> vec3<u32> {
+    return vec3<u32>(floor(0.5 + 255.0 * clamp(color, vec3<f32>(0.0), vec3<f32>(1.0))));
+}
+
+fn write_rgb8(group: u32, pixels: u32) {
+    // 12 bytes of 4 consecutive pixels, pixels past the end are written as
+    // zero padding
+    var bytes: array<u32, 12>;
+    for (var i = 0u; i < 4u; i++) {
+        let index = group * 4u + i;
+        var value = vec3<u32>(0u);
+        if index < pixels {
+            value = to_unorm(display_color(index));
+        }
+        bytes[i * 3u] = value.r;
+        bytes[i * 3u + 1u] = value.g;
+        bytes[i * 3u + 2u] = value.b;
+    }
+    for (var w = 0u; w < 3u; w++) {
+        output[group * 3u + w] = bytes[w * 4u] | (bytes[w * 4u + 1u] << 8u) |
+                                 (bytes[w * 4u + 2u] << 16u) | (bytes[w * 4u + 3u] << 24u);
+    }
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn main(@builtin(global_invocation_id) global_id: vec3<u32>,
+        @builtin(num_workgroups) workgroups: vec3<u32>) {
+    // the dispatch is split over y once x hits the per dimension limit
+    let item = global_id.y * workgroups.x * WORKGROUP_SIZE + global_id.x;
+    let pixels = resolve.width * resolve.height;
+
+    switch resolve.format {
+        case FORMAT_RGB8: {
+            if item * 4u < pixels {
+                write_rgb8(item, pixels);
+            }
+        }
+        case FORMAT_RGBA16F: {
+            if item < pixels {
+                let color = linear_color(item);
+                output[item * 2u] = pack2x16float(color.rg);
+                output[item * 2u + 1u] = pack2x16float(vec2<f32>(color.b, 1.0));
+            }
+        }
+        case FORMAT_RGB32F: {
+            if item < pixels {
+                let color = linear_color(item);
+                output[item * 3u] = bitcast<u32>(color.r);
+                output[item * 3u + 1u] = bitcast<u32>(color.g);
+                output[item * 3u + 2u] = bitcast<u32>(color.b);
+            }
+        }
+        default: {}
+    }
+}
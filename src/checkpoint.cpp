@@ -0,0 +1,149 @@
+#include "checkpoint.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr std::array<char, 4> CHECKPOINT_MAGIC{'T', 'G', 'C', 'K'};
+// version 1 stored a single pass range
+constexpr uint32_t CHECKPOINT_VERSION = 2;
+
+template <typename T> void write_value(std::ofstream &file, const T &value) {
+  file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> T read_value(std::ifstream &file) {
+  T value;
+  file.read(reinterpret_cast<char *>(&value), sizeof(T));
+  return value;
+}
+} // namespace
+
+void save_checkpoint(const std::string &path, const Checkpoint &checkpoint) {
+  auto temp_path = path + ".tmp";
+  {
+    std::ofstream file{temp_path, std::ios::binary};
+    if (!file) {
+      throw std::runtime_error{"failed to open checkpoint file: " + temp_path};
+    }
+    file.write(CHECKPOINT_MAGIC.data(), CHECKPOINT_MAGIC.size());
+    write_value(file, CHECKPOINT_VERSION);
+    write_value(file, checkpoint.width);
+    write_value(file, checkpoint.height);
+    write_value(file, checkpoint.max_depth);
+    write_value(file, checkpoint.scene_hash);
+    write_value(file, static_cast<uint32_t>(checkpoint.passes.size()));
+    for (const auto &range : checkpoint.passes) {
+      write_value(file, range.first);
+      write_value(file, range.next);
+    }
+    write_value(file, checkpoint.samples);
+    file.write(reinterpret_cast<const char *>(checkpoint.accumulation.data()),
+               checkpoint.accumulation.size() * sizeof(glm::vec4));
+    if (!file) {
+      throw std::runtime_error{"failed to write checkpoint file: " +
+                               temp_path};
+    }
+  }
+  std::filesystem::rename(temp_path, path);
+}
+
+Checkpoint load_checkpoint(const std::string &path) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error{"failed to open checkpoint file: " + path};
+  }
+
+  std::array<char, 4> magic;
+  file.read(magic.data(), magic.size());
+  auto version = read_value<uint32_t>(file);
+  if (!file || magic != CHECKPOINT_MAGIC || version == 0 ||
+      version > CHECKPOINT_VERSION) {
+    throw std::runtime_error{"not a checkpoint file: " + path};
+  }
+
+  Checkpoint checkpoint;
+  checkpoint.width = read_value<uint32_t>(file);
+  checkpoint.height = read_value<uint32_t>(file);
+  checkpoint.max_depth = read_value<uint32_t>(file);
+  checkpoint.scene_hash = read_value<uint64_t>(file);
+  uint32_t range_count = version == 1 ? 1 : read_value<uint32_t>(file);
+  for (uint32_t i = 0; i < range_count && file; i++) {
+    PassRange range;
+    range.first = read_value<uint32_t>(file);
+    range.next = read_value<uint32_t>(file);
+    checkpoint.passes.push_back(range);
+  }
+  checkpoint.samples = read_value<uint64_t>(file);
+  checkpoint.accumulation.resize(size_t{checkpoint.width} * checkpoint.height);
+  file.read(reinterpret_cast<char *>(checkpoint.accumulation.data()),
+            checkpoint.accumulation.size() * sizeof(glm::vec4));
+  if (!file) {
+    throw std::runtime_error{"truncated checkpoint file: " + path};
+  }
+  return checkpoint;
+}
+
+Checkpoint merge_checkpoints(const std::vector<Checkpoint> &checkpoints) {
+  if (checkpoints.empty()) {
+    throw std::runtime_error{"no checkpoints to merge"};
+  }
+
+  Checkpoint merged = checkpoints.front();
+  for (size_t i = 1; i < checkpoints.size(); i++) {
+    const auto &other = checkpoints[i];
+    if (other.width != merged.width || other.height != merged.height ||
+        other.max_depth != merged.max_depth ||
+        other.scene_hash != merged.scene_hash) {
+      throw std::runtime_error{
+          "checkpoints are not renders of the same scene and settings"};
+    }
+    merged.passes.insert(merged.passes.end(), other.passes.begin(),
+                         other.passes.end());
+    merged.samples += other.samples;
+    for (size_t p = 0; p < merged.accumulation.size(); p++) {
+      merged.accumulation[p] += other.accumulation[p];
+    }
+  }
+
+  // gaps between ranges are fine, they're just passes nobody rendered yet.
+  // adjacent ranges are joined to keep the list short
+  std::sort(merged.passes.begin(), merged.passes.end(),
+            [](const PassRange &a, const PassRange &b) {
+              return a.first < b.first;
+            });
+  std::vector<PassRange> passes;
+  for (const auto &range : merged.passes) {
+    if (range.first == range.next) {
+      continue;
+    }
+    if (!passes.empty() && range.first < passes.back().next) {
+      // reusing a pass index means reusing its random numbers, and the
+      // correlated samples would bias the merged estimate
+      throw std::runtime_error{"checkpoints have overlapping pass ranges"};
+    }
+    if (!passes.empty() && range.first == passes.back().next) {
+      passes.back().next = range.next;
+    } else {
+      passes.push_back(range);
+    }
+  }
+  merged.passes = std::move(passes);
+  return merged;
+}
+
+std::vector<uint8_t> resolve_checkpoint(const Checkpoint &checkpoint,
+                                        const PostSettings &settings) {
+  std::vector<uint8_t> pixels(checkpoint.accumulation.size() *
+                              pixel_format_bytes(settings.format));
+  post_process(checkpoint.accumulation.data(), checkpoint.accumulation.size(),
+               checkpoint.samples, settings, pixels.data());
+  return pixels;
+}
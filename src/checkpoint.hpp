@@ -0,0 +1,50 @@
+#ifndef CHECKPOINT_HPP_
+#define CHECKPOINT_HPP_
+
+#include "post.hpp"
+
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// rng pass indices [first, next), every pass draws from an independent random
+// stream
+struct PassRange {
+  uint32_t first;
+  uint32_t next;
+
+  bool operator==(const PassRange &) const = default;
+};
+
+// state of a partial render: the running per-pixel sum of samples along with
+// enough bookkeeping to continue it or combine it with other partial renders
+struct Checkpoint {
+  uint32_t width;
+  uint32_t height;
+  uint32_t max_depth;
+  uint64_t scene_hash;
+  // passes that have been accumulated, sorted and disjoint. a render extends
+  // the last range, merging adds ranges
+  std::vector<PassRange> passes;
+  uint64_t samples;
+  // sum of every sample so far in rgb, w is unused
+  std::vector<glm::vec4> accumulation;
+};
+
+// writes to a temporary file first so a crash mid-write never leaves a
+// corrupt checkpoint behind
+void save_checkpoint(const std::string &path, const Checkpoint &checkpoint);
+Checkpoint load_checkpoint(const std::string &path);
+
+// sums partial renders of the same scene whose pass ranges don't overlap,
+// which gives the same estimate as rendering all of their samples in one go
+Checkpoint merge_checkpoints(const std::vector<Checkpoint> &checkpoints);
+
+// averages and post processes the accumulation the same way the gpu resolve
+// pass does, tightly packed in settings.format
+std::vector<uint8_t> resolve_checkpoint(const Checkpoint &checkpoint,
+                                        const PostSettings &settings = {});
+
+#endif // !CHECKPOINT_HPP_
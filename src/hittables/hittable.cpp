@@ -3,23 +3,19 @@
 #include "code.hpp"
 
 #include <format>
-#include <memory>
 #include <string>
 #include <string_view>
 
-Hittable::Hittable(std::shared_ptr<Material> material) : material{material} {}
-
-Hittable::~Hittable() {}
-
-std::string Hittable::place_in_template(std::string_view postfix,
-                                        std::string_view builder) const {
+std::string generate_hit_loop(std::string_view postfix) {
   // clang-format off
   return std::format(CODE(
-      temp_rec = hit_{}({}, ray, tmin, record.t);
-      if temp_rec.hit {{
-          record = temp_rec;
-          {}
+      for (var i: u32 = 0; i < config.{0}_count; i++) {{
+          temp_rec = hit_{0}({0}_at(i), ray, tmin, record.t);
+          if temp_rec.hit {{
+              record = temp_rec;
+              record.material = materials[{0}_materials[i]];
+          }}
       }}
-  ), postfix, builder, material->generate());
+  ), postfix);
   // clang-format on
-  }
+}
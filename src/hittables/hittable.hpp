@@ -1,26 +1,12 @@
 #ifndef HITTABLES_HITTABLE_HPP_
 #define HITTABLES_HITTABLE_HPP_
 
-#include "materials/material.hpp"
-
-#include <format>
-#include <memory>
 #include <string>
 #include <string_view>
 
-class Hittable {
-public:
-  Hittable(std::shared_ptr<Material> material);
-  virtual ~Hittable();
-
-  virtual std::string generate() const = 0;
-
-protected:
-  std::string place_in_template(std::string_view postfix,
-                                std::string_view builder) const;
-
-private:
-  std::shared_ptr<Material> material;
-};
+// generates a loop over every primitive of one type in the scene buffers,
+// expecting config.<postfix>_count, <postfix>_materials, <postfix>_at and
+// hit_<postfix> in the shader
+std::string generate_hit_loop(std::string_view postfix);
 
 #endif // !HITTABLES_HITTABLE_HPP_
@@ -1,13 +1,25 @@
 #include "plane.hpp"
 #include "hittables/hittable.hpp"
 
-Plane::Plane(glm::vec3 point, glm::vec3 normal,
-             std::shared_ptr<Material> material)
-    : Hittable(material), point{point}, normal{normal} {}
-
-std::string Plane::generate() const {
-  auto builder =
-      std::format("Plane(vec3<f32>({}, {}, {}), vec3<f32>({}, {}, {}))",
-                  point.x, point.y, point.z, normal.x, normal.y, normal.z);
-  return place_in_template("plane", builder);
+#include <string>
+
+void Planes::add(glm::vec3 point, glm::vec3 normal, uint32_t material) {
+  points.push_back(point);
+  normals.push_back(normal);
+  materials.push_back(material);
+}
+
+void Planes::reserve(size_t count) {
+  points.reserve(count);
+  normals.reserve(count);
+  materials.reserve(count);
+}
+
+size_t Planes::size() const { return materials.size(); }
+
+std::string Planes::generate() const {
+  if (materials.empty()) {
+    return {};
+  }
+  return generate_hit_loop("plane");
 }
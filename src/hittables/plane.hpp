@@ -1,22 +1,26 @@
 #ifndef HITTABLES_PLANE_HPP_
 #define HITTABLES_PLANE_HPP_
 
-#include "hittable.hpp"
-#include "materials/material.hpp"
-
 #include <glm/vec3.hpp>
 
-#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// every plane in a scene stored column-wise, see Spheres
+struct Planes {
+  std::vector<glm::vec3> points;
+  std::vector<glm::vec3> normals;
+  std::vector<uint32_t> materials;
 
-class Plane : public Hittable {
-public:
-  Plane(glm::vec3 point, glm::vec3 normal, std::shared_ptr<Material> material);
+  void add(glm::vec3 point, glm::vec3 normal, uint32_t material);
+  void reserve(size_t count);
+  size_t size() const;
 
-  virtual std::string generate() const override;
+  std::string generate() const;
 
-private:
-  glm::vec3 point;
-  glm::vec3 normal;
+  bool operator==(const Planes &) const = default;
 };
 
 #endif // !HITTABLES_PLANE_HPP_
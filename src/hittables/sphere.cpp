@@ -1,15 +1,28 @@
 #include "sphere.hpp"
 #include "hittables/hittable.hpp"
 
-#include <format>
-#include <string_view>
+#include <string>
 
-Sphere::Sphere(glm::vec3 center, float radius,
-               std::shared_ptr<Material> material)
-    : Hittable(material), center{center}, radius{radius} {}
+// the shader reads centers as a flat array<f32>
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float));
 
-std::string Sphere::generate() const {
-  auto builder = std::format("Sphere(vec3<f32>({}, {}, {}), {})", center.x,
-                             center.y, center.z, radius);
-  return place_in_template("sphere", builder);
+void Spheres::add(glm::vec3 center, float radius, uint32_t material) {
+  centers.push_back(center);
+  radii.push_back(radius);
+  materials.push_back(material);
+}
+
+void Spheres::reserve(size_t count) {
+  centers.reserve(count);
+  radii.reserve(count);
+  materials.reserve(count);
+}
+
+size_t Spheres::size() const { return materials.size(); }
+
+std::string Spheres::generate() const {
+  if (materials.empty()) {
+    return {};
+  }
+  return generate_hit_loop("sphere");
 }
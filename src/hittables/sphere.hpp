@@ -1,21 +1,28 @@
 #ifndef HITTABLES_SPHERE_H_
 #define HITTABLES_SPHERE_H_
 
-#include "hittable.hpp"
-
 #include <glm/vec3.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
+
+// every sphere in a scene stored column-wise, so host code can walk it
+// directly and each column uploads to the matching sphere_* buffer as is
+struct Spheres {
+  std::vector<glm::vec3> centers;
+  std::vector<float> radii;
+  std::vector<uint32_t> materials;
 
-class Sphere : public Hittable {
-public:
-  Sphere(glm::vec3 center, float radius, std::shared_ptr<Material> material);
+  void add(glm::vec3 center, float radius, uint32_t material);
+  void reserve(size_t count);
+  size_t size() const;
 
-  virtual std::string generate() const override;
+  // empty when there are no spheres so the loop isn't compiled at all
+  std::string generate() const;
 
-private:
-  glm::vec3 center;
-  float radius;
+  bool operator==(const Spheres &) const = default;
 };
 
 #endif // !HITTABLES_SPHERE_H_
@@ -0,0 +1,290 @@
+#include "host_tracer.hpp"
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr float RAY_MAX = 1e30f;
+
+// same hashing and xorshift as compute.wgsl
+uint32_t hash_u32(uint32_t x) {
+  uint32_t state = x * 747796405u + 2891336453u;
+  uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+
+class Rng {
+public:
+  Rng(uint32_t id, uint32_t pass_index)
+      : state{hash_u32(hash_u32(id) ^ pass_index)} {
+    if (state == 0) {
+      state = 1;
+    }
+    next();
+  }
+
+  uint32_t next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  float random_f32() {
+    return static_cast<float>(next()) / static_cast<float>(UINT32_MAX);
+  }
+
+  float random_f32_range(float min, float max) {
+    return min + (max - min) * random_f32();
+  }
+
+  glm::vec3 random_vec3_normalized() {
+    while (true) {
+      // braced so the calls happen in order, like the wgsl constructor
+      glm::vec3 p{random_f32_range(-1.0f, 1.0f), random_f32_range(-1.0f, 1.0f),
+                  random_f32_range(-1.0f, 1.0f)};
+      if (glm::dot(p, p) < 1.0f) {
+        return glm::normalize(p);
+      }
+    }
+  }
+
+private:
+  uint32_t state;
+};
+
+struct Ray {
+  glm::vec3 origin;
+  glm::vec3 direction;
+
+  glm::vec3 at(float t) const { return origin + direction * t; }
+};
+
+struct HitRecord {
+  bool hit = false;
+  float t;
+  glm::vec3 point;
+  glm::vec3 normal;
+  bool front_face;
+  const Material *material;
+
+  void set_face_normal(const Ray &ray) {
+    front_face = glm::dot(ray.direction, normal) < 0.0f;
+    if (!front_face) {
+      normal = -normal;
+    }
+  }
+};
+
+bool hit_sphere(glm::vec3 center, float radius, const Ray &ray, float tmin,
+                float tmax, HitRecord &record) {
+  glm::vec3 oc = ray.origin - center;
+  float a = glm::dot(ray.direction, ray.direction);
+  float half_b = glm::dot(oc, ray.direction);
+  float c = glm::dot(oc, oc) - radius * radius;
+
+  float discriminant = half_b * half_b - a * c;
+  if (discriminant < 0.0f) {
+    return false;
+  }
+
+  float sqrtd = std::sqrt(discriminant);
+  float root = (-half_b - sqrtd) / a;
+  if (root <= tmin || root >= tmax) {
+    root = (-half_b + sqrtd) / a;
+    if (root <= tmin || root >= tmax) {
+      return false;
+    }
+  }
+
+  record.hit = true;
+  record.t = root;
+  record.point = ray.at(root);
+  record.normal = (record.point - center) / radius;
+  record.set_face_normal(ray);
+  return true;
+}
+
+bool hit_plane(glm::vec3 point, glm::vec3 normal, const Ray &ray, float tmin,
+               float tmax, HitRecord &record) {
+  float denom = glm::dot(normal, ray.direction);
+  if (denom <= 1e-6f) {
+    return false;
+  }
+  float t = glm::dot(point - ray.origin, normal) / denom;
+  if (t <= tmin || t >= tmax) {
+    return false;
+  }
+  record.hit = true;
+  record.t = t;
+  record.point = ray.at(t);
+  record.normal = normal;
+  record.set_face_normal(ray);
+  return true;
+}
+
+// same order as the loops generated by Scene::generate
+HitRecord hit_scene(const Scene &scene, const Ray &ray, float tmin,
+                    float tmax) {
+  const auto &materials = scene.materials().materials();
+  HitRecord record;
+  record.t = tmax;
+
+  const auto &spheres = scene.spheres();
+  for (size_t i = 0; i < spheres.size(); i++) {
+    if (hit_sphere(spheres.centers[i], spheres.radii[i], ray, tmin, record.t,
+                   record)) {
+      record.material = &materials[spheres.materials[i]];
+    }
+  }
+  const auto &planes = scene.planes();
+  for (size_t i = 0; i < planes.size(); i++) {
+    if (hit_plane(planes.points[i], planes.normals[i], ray, tmin, record.t,
+                  record)) {
+      record.material = &materials[planes.materials[i]];
+    }
+  }
+  return record;
+}
+
+float reflectance(float cosine, float ref_idx) {
+  float r0 = (1.0f - ref_idx) / (1.0f + ref_idx);
+  r0 = r0 * r0;
+  return r0 + (1.0f - r0) * std::pow(1.0f - cosine, 5.0f);
+}
+
+glm::vec3 ray_color(const Scene &scene, const Ray &ray, uint32_t max_depth,
+                    Rng &rng) {
+  glm::vec3 unit_dir = glm::normalize(ray.direction);
+  float a = 0.5f * (unit_dir.y + 1.0f);
+  glm::vec3 color = (1.0f - a) * glm::vec3{1.0f, 1.0f, 1.0f} +
+                    a * glm::vec3{0.5f, 0.7f, 1.0f};
+  Ray cur_ray = ray;
+  HitRecord record = hit_scene(scene, cur_ray, 0.001f, RAY_MAX);
+  for (uint32_t i = 0; record.hit && i < max_depth; i++) {
+    const Material &material = *record.material;
+    color = glm::vec3{material.data} * color;
+    switch (material.type) {
+    case MaterialType::Metal: {
+      glm::vec3 reflected =
+          glm::reflect(glm::normalize(cur_ray.direction), record.normal);
+      cur_ray = Ray{record.point,
+                    reflected + material.data.w * rng.random_vec3_normalized()};
+      break;
+    }
+    case MaterialType::Dielectric: {
+      float refraction_ratio =
+          record.front_face ? 1.0f / material.data.w : material.data.w;
+
+      glm::vec3 dir = glm::normalize(cur_ray.direction);
+      float cos_theta = std::min(glm::dot(-dir, record.normal), 1.0f);
+      float sin_theta = std::sqrt(1.0f - cos_theta * cos_theta);
+
+      bool cannot_refract = refraction_ratio * sin_theta > 1.0f;
+
+      glm::vec3 direction;
+      if (cannot_refract ||
+          reflectance(cos_theta, refraction_ratio) > rng.random_f32()) {
+        direction = glm::reflect(dir, record.normal);
+      } else {
+        direction = glm::refract(dir, record.normal, refraction_ratio);
+      }
+      cur_ray = Ray{record.point, direction};
+      break;
+    }
+    case MaterialType::Lambertian:
+    default: {
+      glm::vec3 direction = record.normal + rng.random_vec3_normalized();
+      cur_ray = Ray{record.point, direction};
+      break;
+    }
+    }
+    record = hit_scene(scene, cur_ray, 0.001f, RAY_MAX);
+  }
+
+  return color;
+}
+
+glm::vec3 trace_pixel(const Scene &scene, const HostSettings &settings,
+                      uint32_t x, uint32_t y) {
+  const glm::uvec2 dims = settings.size;
+  const uint32_t uid = dims.x * y + x;
+
+  float aspect = static_cast<float>(dims.y) / static_cast<float>(dims.x);
+  float focal_length = 0.5f;
+  float viewport_height = 1.0f;
+  glm::vec2 viewport{viewport_height / aspect, viewport_height};
+  glm::vec2 viewport_delta{viewport.x / static_cast<float>(dims.x),
+                           -viewport.y / static_cast<float>(dims.y)};
+  glm::vec3 viewport_upper_left{
+      glm::vec2{-viewport.x / 2.0f, viewport.y / 2.0f} + 0.5f * viewport_delta,
+      -focal_length};
+  glm::vec3 uv =
+      viewport_upper_left +
+      glm::vec3{viewport_delta * glm::vec2{static_cast<float>(x),
+                                           static_cast<float>(y)},
+                0.0f};
+
+  glm::vec3 sum{0.0f};
+  uint32_t samples = 0;
+  for (uint32_t pass = 0; samples < settings.samples; pass++) {
+    Rng rng{uid, pass};
+    uint32_t pass_samples =
+        std::min(settings.samples_per_pass, settings.samples - samples);
+    for (uint32_t i = 0; i < pass_samples; i++) {
+      glm::vec2 noise{rng.random_f32_range(-0.5f, 0.5f),
+                      rng.random_f32_range(-0.5f, 0.5f)};
+      Ray ray{glm::vec3{0.0f}, uv + glm::vec3{noise * viewport_delta, 0.0f}};
+      sum += ray_color(scene, ray, settings.max_depth, rng);
+    }
+    samples += pass_samples;
+  }
+  return sum;
+}
+} // namespace
+
+Checkpoint trace_scene_host(const Scene &scene, const HostSettings &settings) {
+  const glm::uvec2 size = settings.size;
+  const uint32_t samples_per_pass = std::max(settings.samples_per_pass, 1u);
+  Checkpoint checkpoint{
+      .width = size.x,
+      .height = size.y,
+      .max_depth = settings.max_depth,
+      .scene_hash = hash_scene(scene),
+      .passes = {{0, (settings.samples + samples_per_pass - 1) /
+                         samples_per_pass}},
+      .samples = settings.samples,
+      .accumulation = std::vector<glm::vec4>(size_t{size.x} * size.y),
+  };
+  HostSettings pass_settings = settings;
+  pass_settings.samples_per_pass = samples_per_pass;
+
+  std::atomic<uint32_t> next_row{0};
+  auto worker = [&]() {
+    for (uint32_t y = next_row++; y < size.y; y = next_row++) {
+      for (uint32_t x = 0; x < size.x; x++) {
+        checkpoint.accumulation[size_t{size.x} * y + x] =
+            glm::vec4{trace_pixel(scene, pass_settings, x, y), 0.0f};
+      }
+    }
+  };
+
+  unsigned threads = settings.threads > 0 ? settings.threads
+                                          : std::thread::hardware_concurrency();
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < std::max(threads, 1u); t++) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : workers) {
+    thread.join();
+  }
+  return checkpoint;
+}
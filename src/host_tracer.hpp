@@ -0,0 +1,26 @@
+#ifndef HOST_TRACER_HPP_
+#define HOST_TRACER_HPP_
+
+#include "checkpoint.hpp"
+#include "scene.hpp"
+
+#include <glm/vec2.hpp>
+
+#include <cstdint>
+
+struct HostSettings {
+  glm::uvec2 size;
+  uint32_t samples;
+  uint32_t max_depth;
+  // only affects rng seeding, kept so results line up with gpu passes
+  uint32_t samples_per_pass = 10;
+  // 0 uses every hardware thread available
+  unsigned threads = 0;
+};
+
+// cpu port of compute.wgsl (same camera, rng streams and materials) that
+// walks the scene columns directly. used where there's no gpu, e.g. the
+// golden image tests
+Checkpoint trace_scene_host(const Scene &scene, const HostSettings &settings);
+
+#endif // !HOST_TRACER_HPP_
@@ -1,7 +1,5 @@
 #include "load.hpp"
-#include "hittables/hittable.hpp"
-#include "hittables/plane.hpp"
-#include "hittables/sphere.hpp"
+#include "scene_binary.hpp"
 #include "materials/dielectric.hpp"
 #include "materials/lambertian.hpp"
 #include "materials/material.hpp"
@@ -10,9 +8,9 @@
 #include <yaml-cpp/yaml.h>
 #include <glm/ext/vector_float3.hpp>
 
+#include <cstdint>
 #include <fstream>
 #include <iostream>
-#include <memory>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -37,12 +35,13 @@ glm::vec3 load_vec3(YAML::Node seq) {
   return glm::vec3{x, y, z};
 }
 
-Scene load_scene(const std::string &path) {
+Scene load_scene_yaml(const std::string &path) {
   using namespace std::string_literals;
   YAML::Node yaml = YAML::LoadFile(path);
   SCENE_ASSERT(yaml.IsMap(), "Expected scene root type to be map");
 
-  std::unordered_map<std::string, std::shared_ptr<Material>> materials;
+  Scene scene;
+  std::unordered_map<std::string, uint32_t> materials;
   for (const auto &node : yaml["materials"]) {
     SCENE_ASSERT(node.size() == 1, "Expected hittable to have only one key");
     auto material = *node.begin();
@@ -53,36 +52,44 @@ Scene load_scene(const std::string &path) {
     auto type = inner.first.as<std::string>();
     auto body = inner.second;
     if (type == "lambertian") {
-      materials[name] = std::make_shared<Lambertian>(load_vec3(body["albedo"]));
+      materials[name] =
+          scene.add_material(lambertian(load_vec3(body["albedo"])));
     } else if (type == "dielectric") {
-      materials[name] = std::make_shared<Dielectric>(body["ir"].as<float>());
+      materials[name] = scene.add_material(dielectric(body["ir"].as<float>()));
     } else if (type == "metal") {
-      materials[name] = std::make_shared<Metal>(load_vec3(body["albedo"]),
-                                                body["fuzz"].as<float>());
+      materials[name] = scene.add_material(
+          metal(load_vec3(body["albedo"]), body["fuzz"].as<float>()));
     } else {
       throw std::runtime_error{"unkown material type!"};
     }
   }
 
-  auto red = std::make_shared<Lambertian>(glm::vec3{0.7, 0.0, 0.0});
-  std::vector<std::unique_ptr<Hittable>> hittables;
   for (const auto &node : yaml["hittables"]) {
     SCENE_ASSERT(node.size() == 1, "Expected hittable to have only one key");
     auto hittable = *node.begin();
     auto type = hittable.first.as<std::string>();
     auto body = hittable.second;
-    auto material = materials[body["material"].as<std::string>()];
+    auto material_name = body["material"].as<std::string>();
+    SCENE_ASSERT(materials.contains(material_name),
+                 "unknown material: "s + material_name);
+    auto material = materials[material_name];
     if (type == "sphere") {
-      hittables.push_back(std::make_unique<Sphere>(
-          load_vec3(body["center"]), body["radius"].as<float>(), material));
+      scene.add_sphere(load_vec3(body["center"]), body["radius"].as<float>(),
+                       material);
     } else if (type == "plane") {
-      hittables.push_back(std::make_unique<Plane>(
-          load_vec3(body["point"]), load_vec3(body["normal"]), material));
+      scene.add_plane(load_vec3(body["point"]), load_vec3(body["normal"]),
+                      material);
     } else {
       throw std::runtime_error{"unkown object type!"};
     }
   }
 
-  Scene scene{std::move(hittables)};
   return scene;
 }
+
+Scene load_scene(const std::string &path) {
+  if (is_binary_scene_path(path)) {
+    return load_scene_binary(path);
+  }
+  return load_scene_yaml(path);
+}
@@ -5,6 +5,7 @@
 
 #include <string>
 
+// yaml, or the binary format for .tgs files (see scene_binary.hpp)
 Scene load_scene(const std::string &path);
 
 #endif
@@ -1,3 +1,4 @@
+#include "checkpoint.hpp"
 #include "hittables/hittable.hpp"
 #include "hittables/plane.hpp"
 #include "hittables/sphere.hpp"
@@ -6,32 +7,43 @@
 #include "materials/lambertian.hpp"
 #include "materials/material.hpp"
 #include "materials/metal.hpp"
+#include "output.hpp"
+#include "post.hpp"
 #include "render.hpp"
 #include "scene.hpp"
 
 #include <cmrc/cmrc.hpp>
 #include <cxxopts.hpp>
 #include <glm/vec2.hpp>
-#include <stb_image_write.h>
 #include <webgpu/webgpu_cpp.h>
 #include <webgpu/webgpu_glfw.h>
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <exception>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <ranges>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <system_error>
+#include <thread>
 #include <utility>
 
 CMRC_DECLARE(shaders);
 
 class TracerConfig {
 public:
-  glm::uvec2 size;
+  RenderSettings render;
+  std::string output_file;
+  ImageFormat format;
+  unsigned threads;
 };
 
 glm::uvec2 parse_dims(const std::string &dims_str) {
@@ -41,6 +53,88 @@ glm::uvec2 parse_dims(const std::string &dims_str) {
   return {width, height};
 }
 
+// one csv row per render, with a header when the file is new, so runs over
+// scenes of different sizes can be collected into one table and plotted. the
+// image size and samples go along with the timings as benchmarks shrink the
+// work for large scenes, so render_ms alone isn't comparable between rows
+void append_stats(const std::string &path, const std::string &scene_file,
+                  const Scene &scene, const RenderSettings &settings,
+                  std::chrono::duration<double, std::milli> load,
+                  const RenderStats &stats) {
+  bool exists = std::filesystem::exists(path);
+  std::ofstream file{path, std::ios::app};
+  if (!file) {
+    throw std::runtime_error{"failed to open stats file: " + path};
+  }
+  if (!exists) {
+    file << "scene,spheres,planes,materials,specialized,width,height,samples,"
+            "samples_per_pass,load_ms,codegen_ms,compile_ms,upload_ms,"
+            "render_ms\n";
+  }
+  file << scene_file << ',' << scene.spheres().size() << ','
+       << scene.planes().size() << ',' << scene.materials().size() << ','
+       << settings.specialize << ',' << settings.size.x << ','
+       << settings.size.y << ',' << settings.samples << ','
+       << settings.samples_per_pass << ',' << load.count() << ','
+       << stats.codegen.count() << ',' << stats.compile.count() << ','
+       << stats.upload.count() << ',' << stats.render.count() << '\n';
+}
+
+void render_to_file(Renderer &renderer, const Scene &scene,
+                    const TracerConfig &config,
+                    const Checkpoint *resume = nullptr) {
+  auto output = renderer.render_scene(scene, config.render, resume);
+  write_image(config.output_file, output.view(), config.format,
+              config.threads);
+}
+
+// polls the scene file and re-renders whenever it changes. edits that keep
+// the same primitive and material types reuse the live pipeline, anything
+// else switches to the variant for the new types, compiling it if it's new
+void watch_scene(Renderer &renderer, const std::string &scene_file,
+                 Scene scene, const TracerConfig &config) {
+  namespace fs = std::filesystem;
+  using Milliseconds = std::chrono::duration<double, std::milli>;
+  constexpr auto POLL_INTERVAL = std::chrono::milliseconds{100};
+
+  std::cerr << "watching " << scene_file << " for changes..." << '\n';
+  auto last_write = fs::last_write_time(scene_file);
+  while (true) {
+    std::this_thread::sleep_for(POLL_INTERVAL);
+    std::error_code ec;
+    auto write_time = fs::last_write_time(scene_file, ec);
+    if (ec || write_time == last_write) {
+      continue;
+    }
+    last_write = write_time;
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+      auto next = load_scene(scene_file);
+      auto change = diff_scenes(scene, next);
+      if (change == SceneChange::None) {
+        std::cerr << "[watch] scene unchanged" << '\n';
+        continue;
+      }
+      scene = std::move(next);
+      render_to_file(renderer, scene, config);
+
+      const auto &stats = renderer.last_stats();
+      Milliseconds latency = std::chrono::steady_clock::now() - start;
+      std::cerr << "[watch] "
+                << (change == SceneChange::Parameters ? "parameters updated"
+                    : stats.recompiled ? "structure changed, recompiled"
+                                       : "structure changed, reused cached "
+                                         "pipeline")
+                << ", re-rendered in " << latency.count() << "ms (compile "
+                << stats.compile.count() << "ms, render "
+                << stats.render.count() << "ms)" << '\n';
+    } catch (const std::exception &e) {
+      std::cerr << "[watch] failed to reload scene: " << e.what() << '\n';
+    }
+  }
+}
+
 int main(int argc, char **argv) {
   cxxopts::Options options("traceg",
                            "WebGPU DAWN based GPU-accelerated raytracer");
@@ -48,10 +142,33 @@ int main(int argc, char **argv) {
   options.add_options()
     ("s,scene", "Scene input file", cxxopts::value<std::string>())
     ("o,output", "Output file", cxxopts::value<std::string>())
+    ("f,format", "Output image format (png, ppm, qoi, exr or pfm), defaults to the output file extension",
+     cxxopts::value<std::string>())
+    ("t,threads", "Number of threads used to encode the output image (0 for all)",
+     cxxopts::value<unsigned>()->default_value("0"))
     ("d,dims", "Dimensions of the output image in format WxH (e.g. 1920x1080)",
      cxxopts::value<std::string>()->default_value("640x480"))
     ("a,samples", "Number of samples per pixel", cxxopts::value<uint32_t>()->default_value("100"))
     ("p,depth", "Max recursion depth of a ray", cxxopts::value<uint32_t>()->default_value("10"))
+    ("samples-per-pass", "Samples per pixel taken by each GPU dispatch",
+     cxxopts::value<uint32_t>()->default_value("10"))
+    ("c,checkpoint", "Checkpoint file to write progress to, and the final state once done",
+     cxxopts::value<std::string>())
+    ("checkpoint-every", "Passes between checkpoints (0 to only write one at the end)",
+     cxxopts::value<uint32_t>()->default_value("10"))
+    ("r,resume", "Checkpoint file to resume rendering from", cxxopts::value<std::string>())
+    ("first-pass", "First rng pass index, give separate machines disjoint ranges to merge with traceg-merge",
+     cxxopts::value<uint32_t>()->default_value("0"))
+    ("exposure", "Exposure adjustment in stops", cxxopts::value<float>()->default_value("0"))
+    ("tonemap", "Tonemap curve (none, reinhard or aces), ignored for hdr formats",
+     cxxopts::value<std::string>()->default_value("none"))
+    ("srgb", "Encode 8 bit output as sRGB instead of linear")
+    ("dither", "Dither 8 bit output to hide banding")
+    ("no-specialize", "Compile every material type into the shader instead of only the scene's")
+    ("fallback-adapter", "Render on the cpu fallback adapter (SwiftShader) instead of a gpu")
+    ("stats", "Append load, codegen, compile, upload and render times to this csv file",
+     cxxopts::value<std::string>())
+    ("w,watch", "Keep running and re-render whenever the scene file changes (not with --checkpoint)")
     ("h,help", "Print usage")
     ;
   // clang-format on
@@ -65,26 +182,87 @@ int main(int argc, char **argv) {
     std::cerr << options.help() << '\n';
     return EXIT_FAILURE;
   }
+  // every re-render would overwrite the checkpoint with an edited scene's
+  // state, which a later --resume or traceg-merge can't tell apart
+  if (result.count("watch") > 0 && result.count("checkpoint") > 0) {
+    std::cerr << "--watch can't be combined with --checkpoint" << '\n';
+    return EXIT_FAILURE;
+  }
 
   auto scene_file = result["scene"].as<std::string>();
   auto output_file = result["output"].as<std::string>();
-  auto size = parse_dims(result["dims"].as<std::string>());
-  auto samples = result["samples"].as<uint32_t>();
-  auto depth = result["depth"].as<uint32_t>();
+  TracerConfig config{
+      .render =
+          {
+              .size = parse_dims(result["dims"].as<std::string>()),
+              .samples = result["samples"].as<uint32_t>(),
+              .max_depth = result["depth"].as<uint32_t>(),
+              .samples_per_pass = result["samples-per-pass"].as<uint32_t>(),
+              .first_pass = result["first-pass"].as<uint32_t>(),
+              .checkpoint_every = result["checkpoint-every"].as<uint32_t>(),
+          },
+      .output_file = output_file,
+      .format =
+          result.count("format") > 0
+              ? image_format_from_name(result["format"].as<std::string>())
+              : image_format_from_path(output_file),
+      .threads = result["threads"].as<unsigned>(),
+  };
+  config.render.specialize = result.count("no-specialize") == 0;
+  config.render.post = PostSettings{
+      .exposure = result["exposure"].as<float>(),
+      .tonemap = tonemap_from_name(result["tonemap"].as<std::string>()),
+      .srgb = result.count("srgb") > 0,
+      .dither = result.count("dither") > 0,
+      .format = image_pixel_format(config.format),
+  };
+
+  std::optional<Checkpoint> resume;
+  if (result.count("resume") > 0) {
+    resume = load_checkpoint(result["resume"].as<std::string>());
+    std::cerr << "resuming from " << resume->samples << " samples" << '\n';
+  }
+  if (result.count("checkpoint") > 0) {
+    auto checkpoint_file = result["checkpoint"].as<std::string>();
+    config.render.on_checkpoint = [checkpoint_file](const Checkpoint &state) {
+      save_checkpoint(checkpoint_file, state);
+      std::cerr << "checkpoint: " << state.samples << " samples" << '\n';
+    };
+  }
 
   auto fs = cmrc::shaders::get_filesystem();
 
   auto f = fs.open("compute.wgsl");
   std::string source{f.begin(), f.end()};
-  Renderer renderer{source};
+  auto resolve_f = fs.open("resolve.wgsl");
+  std::string resolve_source{resolve_f.begin(), resolve_f.end()};
+  Renderer renderer{source, resolve_source,
+                    result.count("fallback-adapter") > 0};
   auto props = renderer.adapter_properties();
   std::cerr << "GPU: " << props.name << '\n';
 
+  auto load_start = std::chrono::steady_clock::now();
   Scene scene = load_scene(scene_file);
-  auto output = renderer.render_scene(std::move(scene), size, samples, depth);
+  std::chrono::duration<double, std::milli> load =
+      std::chrono::steady_clock::now() - load_start;
+  try {
+    render_to_file(renderer, scene, config, resume ? &*resume : nullptr);
+    if (result.count("stats") > 0) {
+      append_stats(result["stats"].as<std::string>(), scene_file, scene,
+                   config.render, load, renderer.last_stats());
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "render failed: " << e.what() << '\n';
+    if (result.count("checkpoint") > 0) {
+      std::cerr << "resume from the last checkpoint with --resume "
+                << result["checkpoint"].as<std::string>() << '\n';
+    }
+    return EXIT_FAILURE;
+  }
 
-  stbi_write_png(output_file.c_str(), size.x, size.y, 4, output.data(),
-                 size.x * 4);
+  if (result.count("watch") > 0) {
+    watch_scene(renderer, scene_file, std::move(scene), config);
+  }
 
   return EXIT_SUCCESS;
 }
@@ -3,14 +3,6 @@
 
 #include "material.hpp"
 
-class Dielectric : public Material {
-public:
-  Dielectric(float ir);
-
-  std::string generate() const override;
-
-private:
-  float ir;
-};
+Material dielectric(float ir);
 
 #endif // !MATERIALS_DIELECTRIC_HPP_
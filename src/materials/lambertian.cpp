@@ -1,14 +1,8 @@
 #include "lambertian.hpp"
-#include "code.hpp"
 
-#include <format>
-
-Lambertian::Lambertian(glm::vec3 albedo) : albedo{albedo} {}
-
-std::string Lambertian::generate() const {
-  // clang-format off
-  return std::format(CODE(
-    record.material = Material(MATERIAL_LAMBERTIAN, vec4<f32>({}, {}, {}, 0.0));
-  ), albedo.x, albedo.y, albedo.z);
-  // clang-format on
+Material lambertian(glm::vec3 albedo) {
+  return Material{
+      .type = MaterialType::Lambertian,
+      .data = glm::vec4{albedo, 0.0f},
+  };
 }
@@ -1,4 +1,32 @@
 #include "material.hpp"
 
-Material::Material() {}
-Material::~Material() {}
+#include <functional>
+
+bool Material::operator==(const Material &other) const {
+  return type == other.type && data == other.data;
+}
+
+size_t MaterialHash::operator()(const Material &material) const {
+  size_t hash = std::hash<uint32_t>{}(static_cast<uint32_t>(material.type));
+  for (int i = 0; i < 4; i++) {
+    hash = hash * 31 + std::hash<float>{}(material.data[i]);
+  }
+  return hash;
+}
+
+uint32_t MaterialTable::add(const Material &material) {
+  auto [it, inserted] =
+      indices.try_emplace(material, static_cast<uint32_t>(table.size()));
+  if (inserted) {
+    table.push_back(material);
+  }
+  return it->second;
+}
+
+const std::vector<Material> &MaterialTable::materials() const { return table; }
+
+size_t MaterialTable::size() const { return table.size(); }
+
+bool MaterialTable::operator==(const MaterialTable &other) const {
+  return table == other.table;
+}
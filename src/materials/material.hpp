@@ -1,14 +1,51 @@
 #ifndef MATERIALS_MATERIAL_H_
 #define MATERIALS_MATERIAL_H_
 
-#include <string>
+#include <glm/vec4.hpp>
 
-class Material {
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// must match the MATERIAL_* constants in compute.wgsl
+enum class MaterialType : uint32_t {
+  Lambertian = 0,
+  Metal = 1,
+  Dielectric = 2,
+};
+
+// laid out the same as Material in compute.wgsl so the material table can be
+// copied to the gpu as is
+struct Material {
+  MaterialType type;
+  uint32_t padding[3] = {};
+  // albedo in xyz, fuzz or index of refraction in w
+  glm::vec4 data;
+
+  bool operator==(const Material &other) const;
+};
+
+static_assert(sizeof(Material) == 32);
+
+struct MaterialHash {
+  size_t operator()(const Material &material) const;
+};
+
+// every distinct material in a scene, hittables refer to them by index
+class MaterialTable {
 public:
-  Material();
-  virtual ~Material();
+  // returns the index of an identical material if there already is one
+  uint32_t add(const Material &material);
+
+  const std::vector<Material> &materials() const;
+  size_t size() const;
+
+  bool operator==(const MaterialTable &other) const;
 
-  virtual std::string generate() const = 0;
+private:
+  std::vector<Material> table;
+  std::unordered_map<Material, uint32_t, MaterialHash> indices;
 };
 
 #endif // !MATERIALS_MATERIAL_H_
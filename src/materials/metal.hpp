@@ -5,15 +5,6 @@
 
 #include <glm/vec3.hpp>
 
-class Metal : public Material {
-public:
-  Metal(glm::vec3 albedo, float fuzz);
-
-  std::string generate() const override;
-
-private:
-  glm::vec3 albedo;
-  float fuzz;
-};
+Material metal(glm::vec3 albedo, float fuzz);
 
 #endif // !MATERIALS_METAL_HPP_
@@ -0,0 +1,85 @@
+#include "checkpoint.hpp"
+#include "output.hpp"
+#include "post.hpp"
+
+#include <cxxopts.hpp>
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+  cxxopts::Options options(
+      "traceg-merge",
+      "Combines checkpoints of the same scene rendered over disjoint pass "
+      "ranges (see traceg --first-pass)");
+  // clang-format off
+  options.add_options()
+    ("inputs", "Checkpoint files to merge", cxxopts::value<std::vector<std::string>>())
+    ("c,checkpoint", "Write the merged checkpoint here", cxxopts::value<std::string>())
+    ("o,output", "Write the merged image here", cxxopts::value<std::string>())
+    ("f,format", "Output image format (png, ppm, qoi, exr or pfm), defaults to the output file extension",
+     cxxopts::value<std::string>())
+    ("exposure", "Exposure adjustment in stops", cxxopts::value<float>()->default_value("0"))
+    ("tonemap", "Tonemap curve (none, reinhard or aces), ignored for hdr formats",
+     cxxopts::value<std::string>()->default_value("none"))
+    ("srgb", "Encode 8 bit output as sRGB instead of linear")
+    ("dither", "Dither 8 bit output to hide banding")
+    ("h,help", "Print usage")
+    ;
+  // clang-format on
+  options.parse_positional({"inputs"});
+  options.positional_help("<CHECKPOINT>...").show_positional_help();
+
+  auto result = options.parse(argc, argv);
+
+  if (result.count("help") > 0 || result.count("inputs") == 0 ||
+      (result.count("checkpoint") == 0 && result.count("output") == 0)) {
+    std::cerr << options.help() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  try {
+    std::vector<Checkpoint> checkpoints;
+    for (const auto &path : result["inputs"].as<std::vector<std::string>>()) {
+      checkpoints.push_back(load_checkpoint(path));
+    }
+    auto merged = merge_checkpoints(checkpoints);
+    std::cerr << "merged " << checkpoints.size() << " checkpoints, "
+              << merged.samples << " samples per pixel" << '\n';
+
+    if (result.count("checkpoint") > 0) {
+      save_checkpoint(result["checkpoint"].as<std::string>(), merged);
+    }
+    if (result.count("output") > 0) {
+      auto output_file = result["output"].as<std::string>();
+      auto format =
+          result.count("format") > 0
+              ? image_format_from_name(result["format"].as<std::string>())
+              : image_format_from_path(output_file);
+      PostSettings post{
+          .exposure = result["exposure"].as<float>(),
+          .tonemap = tonemap_from_name(result["tonemap"].as<std::string>()),
+          .srgb = result.count("srgb") > 0,
+          .dither = result.count("dither") > 0,
+          .format = image_pixel_format(format),
+      };
+      auto pixels = resolve_checkpoint(merged, post);
+      ImageView view{
+          .data = pixels.data(),
+          .width = merged.width,
+          .height = merged.height,
+          .stride = size_t{merged.width} * pixel_format_bytes(post.format),
+          .format = post.format,
+      };
+      write_image(output_file, view, format);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "merge failed: " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
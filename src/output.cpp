@@ -0,0 +1,568 @@
+#include "output.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+uint32_t pixel_format_channels(PixelFormat format) {
+  switch (format) {
+  case PixelFormat::RGB8:
+  case PixelFormat::RGB32F:
+    return 3;
+  case PixelFormat::RGBA16F:
+    return 4;
+  }
+  throw std::runtime_error{"unknown pixel format!"};
+}
+
+uint32_t pixel_format_bytes(PixelFormat format) {
+  switch (format) {
+  case PixelFormat::RGB8:
+    return 3;
+  case PixelFormat::RGBA16F:
+    return 8;
+  case PixelFormat::RGB32F:
+    return 12;
+  }
+  throw std::runtime_error{"unknown pixel format!"};
+}
+
+bool pixel_format_is_hdr(PixelFormat format) {
+  return format == PixelFormat::RGBA16F || format == PixelFormat::RGB32F;
+}
+
+ImageFormat image_format_from_name(const std::string &name) {
+  std::string lower;
+  std::transform(name.begin(), name.end(), std::back_inserter(lower),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (lower == "png") {
+    return ImageFormat::PNG;
+  } else if (lower == "ppm") {
+    return ImageFormat::PPM;
+  } else if (lower == "qoi") {
+    return ImageFormat::QOI;
+  } else if (lower == "exr") {
+    return ImageFormat::EXR;
+  } else if (lower == "pfm") {
+    return ImageFormat::PFM;
+  }
+  throw std::runtime_error{"unknown image format: " + name};
+}
+
+ImageFormat image_format_from_path(const std::string &path) {
+  auto extension = std::filesystem::path{path}.extension().string();
+  if (extension.empty()) {
+    return ImageFormat::PNG;
+  }
+  return image_format_from_name(extension.substr(1));
+}
+
+PixelFormat image_pixel_format(ImageFormat format) {
+  switch (format) {
+  case ImageFormat::PNG:
+  case ImageFormat::PPM:
+  case ImageFormat::QOI:
+    return PixelFormat::RGB8;
+  case ImageFormat::EXR:
+    return PixelFormat::RGBA16F;
+  case ImageFormat::PFM:
+    return PixelFormat::RGB32F;
+  }
+  throw std::runtime_error{"unknown image format!"};
+}
+
+namespace {
+void put_u32_be(std::vector<uint8_t> &out, uint32_t value) {
+  out.push_back(static_cast<uint8_t>(value >> 24));
+  out.push_back(static_cast<uint8_t>(value >> 16));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+template <typename T> void put_le(std::vector<uint8_t> &out, T value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  auto bytes = std::bit_cast<std::array<uint8_t, sizeof(T)>>(value);
+  if constexpr (std::endian::native == std::endian::big) {
+    std::reverse(bytes.begin(), bytes.end());
+  }
+  out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+void require_format(const ImageView &image, PixelFormat format,
+                    const char *encoder) {
+  if (image.format != format) {
+    throw std::runtime_error{std::string{"pixel format can't be written as "} +
+                             encoder};
+  }
+}
+
+std::ofstream open_output(const std::string &path) {
+  std::ofstream file{path, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error{"failed to open output file: " + path};
+  }
+  return file;
+}
+
+unsigned resolve_threads(unsigned threads) {
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+  return std::max(threads, 1u);
+}
+
+// runs job(i) for every i in [0, count) spread across threads workers
+template <typename Job>
+void parallel_for(size_t count, unsigned threads, const Job &job) {
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t i = next++; i < count; i = next++) {
+      job(i);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < std::min<size_t>(threads, count); t++) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : workers) {
+    thread.join();
+  }
+}
+
+// PNG
+
+constexpr std::array<uint8_t, 8> PNG_SIGNATURE{0x89, 'P',  'N',  'G',
+                                               '\r', '\n', 0x1a, '\n'};
+// zlib header for a 32K window with the default compression level
+constexpr std::array<uint8_t, 2> ZLIB_HEADER{0x78, 0x9c};
+constexpr size_t DEFLATE_CHUNK = 1 << 16;
+
+uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+  int p = a + b - c;
+  int pa = std::abs(p - a);
+  int pb = std::abs(p - b);
+  int pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  } else if (pb <= pc) {
+    return b;
+  }
+  return c;
+}
+
+// applies every PNG filter to row and leaves the one with the smallest sum of
+// absolute (signed) residuals in best, the same heuristic libpng uses
+void filter_row(const uint8_t *row, const uint8_t *prev, size_t length,
+                size_t bpp, std::array<std::vector<uint8_t>, 5> &scratch,
+                std::vector<uint8_t> *&best) {
+  uint64_t best_score = UINT64_MAX;
+  for (uint8_t type = 0; type < scratch.size(); type++) {
+    auto &out = scratch[type];
+    out[0] = type;
+    uint64_t score = 0;
+    for (size_t i = 0; i < length; i++) {
+      uint8_t a = i >= bpp ? row[i - bpp] : 0;
+      uint8_t b = prev[i];
+      uint8_t c = i >= bpp ? prev[i - bpp] : 0;
+      uint8_t predictor = 0;
+      switch (type) {
+      case 1:
+        predictor = a;
+        break;
+      case 2:
+        predictor = b;
+        break;
+      case 3:
+        predictor = static_cast<uint8_t>((a + b) / 2);
+        break;
+      case 4:
+        predictor = paeth(a, b, c);
+        break;
+      }
+      uint8_t residual = row[i] - predictor;
+      out[i + 1] = residual;
+      score += std::abs(static_cast<int8_t>(residual));
+    }
+    if (score < best_score) {
+      best_score = score;
+      best = &out;
+    }
+  }
+}
+
+void deflate_into(z_stream &stream, std::vector<uint8_t> &out,
+                  const uint8_t *data, size_t size, int flush) {
+  stream.next_in = const_cast<Bytef *>(data);
+  stream.avail_in = static_cast<uInt>(size);
+  do {
+    if (stream.total_out == out.size()) {
+      out.resize(out.size() + DEFLATE_CHUNK);
+    }
+    stream.next_out = out.data() + stream.total_out;
+    stream.avail_out = static_cast<uInt>(out.size() - stream.total_out);
+    deflate(&stream, flush);
+  } while (stream.avail_out == 0);
+}
+
+// each strip of rows is filtered and deflated on its own and stored as a
+// complete IDAT chunk. every strip but the last ends on a sync flush so the
+// raw deflate streams concatenate into one valid zlib stream
+struct PngStrip {
+  uint32_t first_row;
+  uint32_t rows;
+  std::vector<uint8_t> chunk = {};
+  uLong adler = 0;
+  size_t raw_size = 0;
+};
+
+void encode_png_strip(const ImageView &image, PngStrip &strip, bool first,
+                      bool last) {
+  const size_t bpp = pixel_format_channels(image.format);
+  const size_t length = image.width * bpp;
+  strip.raw_size = (length + 1) * strip.rows;
+
+  z_stream stream{};
+  // negative window bits produce raw deflate without zlib framing
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error{"failed to initialize deflate"};
+  }
+
+  // chunk layout: length (4) | "IDAT" | [zlib header] | deflate | [adler]
+  std::vector<uint8_t> &chunk = strip.chunk;
+  chunk = {0, 0, 0, 0, 'I', 'D', 'A', 'T'};
+  if (first) {
+    chunk.insert(chunk.end(), ZLIB_HEADER.begin(), ZLIB_HEADER.end());
+  }
+
+  std::vector<uint8_t> zeros(length, 0);
+  std::array<std::vector<uint8_t>, 5> scratch;
+  for (auto &buffer : scratch) {
+    buffer.resize(length + 1);
+  }
+
+  std::vector<uint8_t> deflated(deflateBound(&stream, strip.raw_size));
+  strip.adler = adler32(0, nullptr, 0);
+  for (uint32_t y = strip.first_row; y < strip.first_row + strip.rows; y++) {
+    const uint8_t *prev = y == 0 ? zeros.data() : image.row(y - 1);
+    std::vector<uint8_t> *filtered = nullptr;
+    filter_row(image.row(y), prev, length, bpp, scratch, filtered);
+    strip.adler = adler32(strip.adler, filtered->data(),
+                          static_cast<uInt>(filtered->size()));
+    bool end = y + 1 == strip.first_row + strip.rows;
+    int flush = !end ? Z_NO_FLUSH : last ? Z_FINISH : Z_SYNC_FLUSH;
+    deflate_into(stream, deflated, filtered->data(), filtered->size(), flush);
+  }
+  deflated.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  chunk.insert(chunk.end(), deflated.begin(), deflated.end());
+}
+
+void finish_png_chunk(std::vector<uint8_t> &chunk) {
+  uint32_t length = static_cast<uint32_t>(chunk.size() - 8);
+  chunk[0] = static_cast<uint8_t>(length >> 24);
+  chunk[1] = static_cast<uint8_t>(length >> 16);
+  chunk[2] = static_cast<uint8_t>(length >> 8);
+  chunk[3] = static_cast<uint8_t>(length);
+  uLong crc = crc32(0, chunk.data() + 4, static_cast<uInt>(chunk.size() - 4));
+  put_u32_be(chunk, static_cast<uint32_t>(crc));
+}
+
+std::vector<uint8_t> png_chunk(const char *type,
+                               const std::vector<uint8_t> &data) {
+  std::vector<uint8_t> chunk{0, 0, 0, 0};
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+  finish_png_chunk(chunk);
+  return chunk;
+}
+
+void write_png(const std::string &path, const ImageView &image,
+               unsigned threads) {
+  require_format(image, PixelFormat::RGB8, "png");
+
+  // a few strips per thread keeps the workers balanced while each strip
+  // stays large enough that restarting the deflate window costs little
+  threads = resolve_threads(threads);
+  uint32_t strip_count = std::clamp<uint32_t>(threads * 4, 1, image.height);
+  uint32_t rows_per_strip = (image.height + strip_count - 1) / strip_count;
+  std::vector<PngStrip> strips;
+  for (uint32_t y = 0; y < image.height; y += rows_per_strip) {
+    strips.push_back(PngStrip{
+        .first_row = y,
+        .rows = std::min(rows_per_strip, image.height - y),
+    });
+  }
+
+  parallel_for(strips.size(), threads, [&](size_t i) {
+    encode_png_strip(image, strips[i], i == 0, i + 1 == strips.size());
+    if (i + 1 != strips.size()) {
+      finish_png_chunk(strips[i].chunk);
+    }
+  });
+
+  uLong adler = strips.front().adler;
+  for (size_t i = 1; i < strips.size(); i++) {
+    adler = adler32_combine(adler, strips[i].adler,
+                            static_cast<z_off_t>(strips[i].raw_size));
+  }
+  put_u32_be(strips.back().chunk, static_cast<uint32_t>(adler));
+  finish_png_chunk(strips.back().chunk);
+
+  std::vector<uint8_t> header;
+  put_u32_be(header, image.width);
+  put_u32_be(header, image.height);
+  // 8 bit truecolor, no interlacing
+  header.insert(header.end(), {8, 2, 0, 0, 0});
+
+  auto file = open_output(path);
+  file.write(reinterpret_cast<const char *>(PNG_SIGNATURE.data()),
+             PNG_SIGNATURE.size());
+  auto ihdr = png_chunk("IHDR", header);
+  file.write(reinterpret_cast<const char *>(ihdr.data()), ihdr.size());
+  for (const auto &strip : strips) {
+    file.write(reinterpret_cast<const char *>(strip.chunk.data()),
+               strip.chunk.size());
+  }
+  auto iend = png_chunk("IEND", {});
+  file.write(reinterpret_cast<const char *>(iend.data()), iend.size());
+}
+
+// PPM
+
+void write_ppm(const std::string &path, const ImageView &image) {
+  require_format(image, PixelFormat::RGB8, "ppm");
+  auto file = open_output(path);
+  file << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+  // rows are already tightly packed RGB
+  const size_t length = size_t{image.width} * pixel_format_bytes(image.format);
+  for (uint32_t y = 0; y < image.height; y++) {
+    file.write(reinterpret_cast<const char *>(image.row(y)), length);
+  }
+}
+
+// QOI (https://qoiformat.org/qoi-specification.pdf)
+
+constexpr uint8_t QOI_OP_INDEX = 0x00;
+constexpr uint8_t QOI_OP_DIFF = 0x40;
+constexpr uint8_t QOI_OP_LUMA = 0x80;
+constexpr uint8_t QOI_OP_RUN = 0xc0;
+constexpr uint8_t QOI_OP_RGB = 0xfe;
+constexpr uint8_t QOI_OP_RGBA = 0xff;
+
+struct QoiPixel {
+  uint8_t r, g, b, a;
+
+  bool operator==(const QoiPixel &) const = default;
+  size_t hash() const { return (r * 3 + g * 5 + b * 7 + a * 11) % 64; }
+};
+
+void write_qoi(const std::string &path, const ImageView &image) {
+  require_format(image, PixelFormat::RGB8, "qoi");
+  std::vector<uint8_t> out{'q', 'o', 'i', 'f'};
+  put_u32_be(out, image.width);
+  put_u32_be(out, image.height);
+  out.push_back(3);
+  out.push_back(0); // sRGB with linear alpha
+  out.reserve(out.size() + image.width * image.height * 4 + 8);
+
+  std::array<QoiPixel, 64> index{};
+  QoiPixel prev{0, 0, 0, 255};
+  uint8_t run = 0;
+  for (uint32_t y = 0; y < image.height; y++) {
+    const uint8_t *row = image.row(y);
+    for (uint32_t x = 0; x < image.width; x++) {
+      const uint8_t *p = &row[x * 3];
+      QoiPixel px{p[0], p[1], p[2], 255};
+      bool last = y + 1 == image.height && x + 1 == image.width;
+
+      if (px == prev) {
+        run++;
+        if (run == 62 || last) {
+          out.push_back(static_cast<uint8_t>(QOI_OP_RUN | (run - 1)));
+          run = 0;
+        }
+        continue;
+      }
+      if (run > 0) {
+        out.push_back(static_cast<uint8_t>(QOI_OP_RUN | (run - 1)));
+        run = 0;
+      }
+
+      size_t hash = px.hash();
+      if (index[hash] == px) {
+        out.push_back(QOI_OP_INDEX | static_cast<uint8_t>(hash));
+      } else if (px.a == prev.a) {
+        index[hash] = px;
+        int8_t vr = static_cast<int8_t>(px.r - prev.r);
+        int8_t vg = static_cast<int8_t>(px.g - prev.g);
+        int8_t vb = static_cast<int8_t>(px.b - prev.b);
+        int8_t vg_r = static_cast<int8_t>(vr - vg);
+        int8_t vg_b = static_cast<int8_t>(vb - vg);
+        if (vr >= -2 && vr <= 1 && vg >= -2 && vg <= 1 && vb >= -2 &&
+            vb <= 1) {
+          out.push_back(static_cast<uint8_t>(QOI_OP_DIFF | (vr + 2) << 4 |
+                                             (vg + 2) << 2 | (vb + 2)));
+        } else if (vg_r >= -8 && vg_r <= 7 && vg >= -32 && vg <= 31 &&
+                   vg_b >= -8 && vg_b <= 7) {
+          out.push_back(static_cast<uint8_t>(QOI_OP_LUMA | (vg + 32)));
+          out.push_back(static_cast<uint8_t>((vg_r + 8) << 4 | (vg_b + 8)));
+        } else {
+          out.insert(out.end(), {QOI_OP_RGB, px.r, px.g, px.b});
+        }
+      } else {
+        index[hash] = px;
+        out.insert(out.end(), {QOI_OP_RGBA, px.r, px.g, px.b, px.a});
+      }
+      prev = px;
+    }
+  }
+  out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+
+  auto file = open_output(path);
+  file.write(reinterpret_cast<const char *>(out.data()), out.size());
+}
+
+// PFM
+
+void write_pfm(const std::string &path, const ImageView &image) {
+  require_format(image, PixelFormat::RGB32F, "pfm");
+  auto file = open_output(path);
+  // a negative scale marks little endian data
+  file << "PF\n"
+       << image.width << ' ' << image.height << '\n'
+       << (std::endian::native == std::endian::little ? "-1.0" : "1.0")
+       << '\n';
+  // rows are stored bottom to top
+  const size_t length = size_t{image.width} * pixel_format_bytes(image.format);
+  for (uint32_t y = image.height; y-- > 0;) {
+    file.write(reinterpret_cast<const char *>(image.row(y)), length);
+  }
+}
+
+// EXR (https://openexr.com/en/latest/OpenEXRFileLayout.html), single part
+// scanline image without compression
+
+constexpr std::array<uint8_t, 4> EXR_MAGIC{0x76, 0x2f, 0x31, 0x01};
+constexpr uint32_t EXR_VERSION = 2;
+constexpr int32_t EXR_PIXEL_HALF = 1;
+
+void put_exr_attribute(std::vector<uint8_t> &out, const char *name,
+                       const char *type, const std::vector<uint8_t> &value) {
+  out.insert(out.end(), name, name + std::strlen(name) + 1);
+  out.insert(out.end(), type, type + std::strlen(type) + 1);
+  put_le(out, static_cast<int32_t>(value.size()));
+  out.insert(out.end(), value.begin(), value.end());
+}
+
+void write_exr(const std::string &path, const ImageView &image) {
+  require_format(image, PixelFormat::RGBA16F, "exr");
+  // channels are stored in alphabetical order, each as its own run of
+  // values per scanline
+  constexpr std::array<std::pair<char, size_t>, 4> CHANNELS{
+      {{'A', 3}, {'B', 2}, {'G', 1}, {'R', 0}}};
+  constexpr size_t HALF_SIZE = 2;
+  const int32_t max_x = static_cast<int32_t>(image.width) - 1;
+  const int32_t max_y = static_cast<int32_t>(image.height) - 1;
+
+  std::vector<uint8_t> out{EXR_MAGIC.begin(), EXR_MAGIC.end()};
+  put_le(out, EXR_VERSION);
+
+  std::vector<uint8_t> channels;
+  for (auto [name, offset] : CHANNELS) {
+    channels.insert(channels.end(), {static_cast<uint8_t>(name), 0});
+    put_le(channels, EXR_PIXEL_HALF);
+    // pLinear and three reserved bytes
+    channels.insert(channels.end(), {0, 0, 0, 0});
+    put_le(channels, int32_t{1});
+    put_le(channels, int32_t{1});
+  }
+  channels.push_back(0);
+  std::vector<uint8_t> window;
+  for (int32_t value : {0, 0, max_x, max_y}) {
+    put_le(window, value);
+  }
+  std::vector<uint8_t> center;
+  put_le(center, 0.0f);
+  put_le(center, 0.0f);
+  std::vector<uint8_t> one;
+  put_le(one, 1.0f);
+
+  put_exr_attribute(out, "channels", "chlist", channels);
+  put_exr_attribute(out, "compression", "compression", {0});
+  put_exr_attribute(out, "dataWindow", "box2i", window);
+  put_exr_attribute(out, "displayWindow", "box2i", window);
+  put_exr_attribute(out, "lineOrder", "lineOrder", {0});
+  put_exr_attribute(out, "pixelAspectRatio", "float", one);
+  put_exr_attribute(out, "screenWindowCenter", "v2f", center);
+  put_exr_attribute(out, "screenWindowWidth", "float", one);
+  out.push_back(0);
+
+  // offset table, one block per scanline
+  const size_t line_bytes = size_t{image.width} * CHANNELS.size() * HALF_SIZE;
+  const size_t block_bytes = 2 * sizeof(int32_t) + line_bytes;
+  const size_t first_block = out.size() + size_t{image.height} * sizeof(uint64_t);
+  for (uint32_t y = 0; y < image.height; y++) {
+    put_le(out, static_cast<uint64_t>(first_block + y * block_bytes));
+  }
+
+  out.reserve(first_block + image.height * block_bytes);
+  for (uint32_t y = 0; y < image.height; y++) {
+    put_le(out, static_cast<int32_t>(y));
+    put_le(out, static_cast<int32_t>(line_bytes));
+    const uint8_t *row = image.row(y);
+    for (auto [name, offset] : CHANNELS) {
+      for (uint32_t x = 0; x < image.width; x++) {
+        uint16_t half;
+        std::memcpy(&half, row + (x * CHANNELS.size() + offset) * HALF_SIZE,
+                    HALF_SIZE);
+        put_le(out, half);
+      }
+    }
+  }
+
+  auto file = open_output(path);
+  file.write(reinterpret_cast<const char *>(out.data()), out.size());
+}
+} // namespace
+
+void write_image(const std::string &path, const ImageView &image,
+                 ImageFormat format, unsigned threads) {
+  // png and qoi can't hold an empty image, and it's never intended for the rest
+  if (image.width == 0 || image.height == 0) {
+    throw std::runtime_error{"can't write an empty image"};
+  }
+  switch (format) {
+  case ImageFormat::PNG:
+    write_png(path, image, threads);
+    break;
+  case ImageFormat::PPM:
+    write_ppm(path, image);
+    break;
+  case ImageFormat::QOI:
+    write_qoi(path, image);
+    break;
+  case ImageFormat::EXR:
+    write_exr(path, image);
+    break;
+  case ImageFormat::PFM:
+    write_pfm(path, image);
+    break;
+  }
+}
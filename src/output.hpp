@@ -0,0 +1,50 @@
+#ifndef OUTPUT_HPP_
+#define OUTPUT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// values must match the FORMAT_* constants in resolve.wgsl
+enum class PixelFormat : uint32_t {
+  RGB8 = 0,
+  RGBA16F = 1,
+  RGB32F = 2,
+};
+
+uint32_t pixel_format_channels(PixelFormat format);
+uint32_t pixel_format_bytes(PixelFormat format);
+bool pixel_format_is_hdr(PixelFormat format);
+
+// non-owning view over rows of pixels that may be padded (e.g. a mapped
+// readback buffer), so encoders never need a tightly packed copy
+struct ImageView {
+  const uint8_t *data;
+  uint32_t width;
+  uint32_t height;
+  size_t stride;
+  PixelFormat format;
+
+  const uint8_t *row(uint32_t y) const { return data + stride * y; }
+};
+
+enum class ImageFormat {
+  PNG,
+  PPM,
+  QOI,
+  // half float, uncompressed
+  EXR,
+  PFM,
+};
+
+ImageFormat image_format_from_name(const std::string &name);
+ImageFormat image_format_from_path(const std::string &path);
+// the pixel format the encoder for an image format takes, so renders can be
+// packed the way they are written
+PixelFormat image_pixel_format(ImageFormat format);
+
+// threads == 0 uses every hardware thread available
+void write_image(const std::string &path, const ImageView &image,
+                 ImageFormat format, unsigned threads = 0);
+
+#endif // !OUTPUT_HPP_
@@ -0,0 +1,134 @@
+#include "post.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+Tonemap tonemap_from_name(const std::string &name) {
+  if (name == "none") {
+    return Tonemap::None;
+  } else if (name == "reinhard") {
+    return Tonemap::Reinhard;
+  } else if (name == "aces") {
+    return Tonemap::ACES;
+  }
+  throw std::runtime_error{"unknown tonemap: " + name};
+}
+
+namespace {
+// same hash as resolve.wgsl, so dithering matches the gpu
+uint32_t hash_u32(uint32_t input) {
+  uint32_t state = input * 747796405u + 2891336453u;
+  uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+
+float tonemap(float value, Tonemap tonemap) {
+  switch (tonemap) {
+  case Tonemap::None:
+    return value;
+  case Tonemap::Reinhard:
+    return value / (1.0f + value);
+  case Tonemap::ACES:
+    // Narkowicz's fit of the ACES filmic curve
+    return std::clamp((value * (2.51f * value + 0.03f)) /
+                          (value * (2.43f * value + 0.59f) + 0.14f),
+                      0.0f, 1.0f);
+  }
+  return value;
+}
+
+float srgb_encode(float value) {
+  value = std::clamp(value, 0.0f, 1.0f);
+  if (value <= 0.0031308f) {
+    return 12.92f * value;
+  }
+  return 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+uint8_t to_unorm(float value) {
+  return static_cast<uint8_t>(
+      std::floor(0.5f + 255.0f * std::clamp(value, 0.0f, 1.0f)));
+}
+
+// round to nearest even like pack2x16float, inputs are non-negative colors
+// so there are no signs or nans to deal with
+uint16_t to_half(float value) {
+  uint32_t bits = std::bit_cast<uint32_t>(value);
+  uint32_t sign = (bits >> 16) & 0x8000u;
+  int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xffu) - 127 + 15;
+  uint32_t mantissa = bits & 0x7fffffu;
+  if (exponent >= 31) {
+    return static_cast<uint16_t>(sign | 0x7c00u);
+  }
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return static_cast<uint16_t>(sign);
+    }
+    mantissa |= 0x800000u;
+    uint32_t shift = static_cast<uint32_t>(14 - exponent);
+    uint32_t half = mantissa >> shift;
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1u))) {
+      half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+  }
+  uint32_t half = sign | static_cast<uint32_t>(exponent) << 10 | mantissa >> 13;
+  uint32_t rest = mantissa & 0x1fffu;
+  if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) {
+    half++;
+  }
+  return static_cast<uint16_t>(half);
+}
+} // namespace
+
+void post_process(const glm::vec4 *accumulation, size_t pixels,
+                  uint64_t samples, const PostSettings &settings,
+                  uint8_t *out) {
+  const float exposure = std::exp2(settings.exposure);
+  const float sample_count = static_cast<float>(samples);
+  const bool hdr = pixel_format_is_hdr(settings.format);
+  for (size_t i = 0; i < pixels; i++) {
+    glm::vec3 color{0.0f};
+    if (samples > 0) {
+      color = glm::vec3{accumulation[i]} / sample_count;
+    }
+    color *= exposure;
+
+    if (hdr) {
+      if (settings.format == PixelFormat::RGB32F) {
+        std::memcpy(out + i * 12, &color, 12);
+      } else {
+        uint16_t halves[4] = {to_half(color.x), to_half(color.y),
+                              to_half(color.z), to_half(1.0f)};
+        std::memcpy(out + i * 8, halves, 8);
+      }
+      continue;
+    }
+
+    for (int c = 0; c < 3; c++) {
+      color[c] = tonemap(color[c], settings.tonemap);
+      if (settings.srgb) {
+        color[c] = srgb_encode(color[c]);
+      }
+    }
+    if (settings.dither) {
+      uint32_t hash = hash_u32(static_cast<uint32_t>(i));
+      float noise = static_cast<float>(hash & 0xffffu) / 65536.0f -
+                    static_cast<float>(hash >> 16) / 65536.0f;
+      color += glm::vec3{noise / 255.0f};
+    }
+
+    uint8_t *pixel = out + i * 3;
+    pixel[0] = to_unorm(color.x);
+    pixel[1] = to_unorm(color.y);
+    pixel[2] = to_unorm(color.z);
+  }
+}
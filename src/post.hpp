@@ -0,0 +1,40 @@
+#ifndef POST_HPP_
+#define POST_HPP_
+
+#include "output.hpp"
+
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// values must match the TONEMAP_* constants in resolve.wgsl
+enum class Tonemap : uint32_t {
+  None = 0,
+  Reinhard = 1,
+  ACES = 2,
+};
+
+Tonemap tonemap_from_name(const std::string &name);
+
+// what the resolve pass does to the averaged samples before packing them.
+// hdr formats keep linear values, so only exposure applies to them
+struct PostSettings {
+  // in stops
+  float exposure = 0.0f;
+  Tonemap tonemap = Tonemap::None;
+  bool srgb = false;
+  // one 8 bit step of triangular noise against banding
+  bool dither = false;
+  PixelFormat format = PixelFormat::RGB8;
+};
+
+// cpu version of resolve.wgsl: averages the per-pixel sums of samples and
+// writes them tightly packed in settings.format to out, which must hold
+// pixels * pixel_format_bytes(settings.format) bytes
+void post_process(const glm::vec4 *accumulation, size_t pixels,
+                  uint64_t samples, const PostSettings &settings,
+                  uint8_t *out);
+
+#endif // !POST_HPP_
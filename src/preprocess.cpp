@@ -0,0 +1,110 @@
+#include "preprocess.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+struct Conditional {
+  // whether lines in the current branch are kept
+  bool active;
+  // whether the enclosing block was active, #else can't turn on a branch
+  // inside an inactive block
+  bool parent_active;
+  bool seen_else;
+  size_t line;
+};
+
+std::string_view trim(std::string_view text) {
+  auto first = text.find_first_not_of(" \t\r");
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  auto last = text.find_last_not_of(" \t\r");
+  return text.substr(first, last - first + 1);
+}
+
+[[noreturn]] void fail(size_t line, const std::string &message) {
+  throw std::runtime_error{"shader preprocessor, line " +
+                           std::to_string(line) + ": " + message};
+}
+} // namespace
+
+std::string preprocess(std::string_view source,
+                       std::unordered_set<std::string> defines) {
+  std::string output;
+  output.reserve(source.size());
+  std::vector<Conditional> stack;
+  size_t line_number = 0;
+
+  while (!source.empty()) {
+    line_number++;
+    auto end = source.find('\n');
+    std::string_view line = source.substr(0, end);
+    source = end == std::string_view::npos ? std::string_view{}
+                                           : source.substr(end + 1);
+    bool active = stack.empty() || stack.back().active;
+
+    std::string_view text = trim(line);
+    if (text.empty() || text.front() != '#') {
+      if (active) {
+        output += line;
+      }
+      output += '\n';
+      continue;
+    }
+
+    text.remove_prefix(1);
+    auto space = text.find_first_of(" \t");
+    std::string_view directive = text.substr(0, space);
+    std::string name{space == std::string_view::npos
+                         ? std::string_view{}
+                         : trim(text.substr(space))};
+    bool needs_name = directive == "define" || directive == "undef" ||
+                      directive == "ifdef" || directive == "ifndef";
+    if (needs_name && name.empty()) {
+      fail(line_number, "#" + std::string{directive} + " without a name");
+    }
+
+    if (directive == "define") {
+      if (active) {
+        defines.insert(name);
+      }
+    } else if (directive == "undef") {
+      if (active) {
+        defines.erase(name);
+      }
+    } else if (directive == "ifdef" || directive == "ifndef") {
+      bool defined = defines.contains(name);
+      stack.push_back(Conditional{
+          .active = active && defined == (directive == "ifdef"),
+          .parent_active = active,
+          .seen_else = false,
+          .line = line_number,
+      });
+    } else if (directive == "else") {
+      if (stack.empty() || stack.back().seen_else) {
+        fail(line_number, "#else without a matching #ifdef");
+      }
+      auto &conditional = stack.back();
+      conditional.active = conditional.parent_active && !conditional.active;
+      conditional.seen_else = true;
+    } else if (directive == "endif") {
+      if (stack.empty()) {
+        fail(line_number, "#endif without a matching #ifdef");
+      }
+      stack.pop_back();
+    } else {
+      fail(line_number, "unknown directive #" + std::string{directive});
+    }
+    output += '\n';
+  }
+
+  if (!stack.empty()) {
+    fail(stack.back().line, "#ifdef without a matching #endif");
+  }
+  return output;
+}
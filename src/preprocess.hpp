@@ -0,0 +1,15 @@
+#ifndef PREPROCESS_HPP_
+#define PREPROCESS_HPP_
+
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+// tiny preprocessor for wgsl supporting #define NAME, #undef NAME, #ifdef,
+// #ifndef, #else and #endif. defines have no values and nothing is
+// expanded, they only switch code on and off. removed lines are left empty
+// so compiler errors still point at the right line
+std::string preprocess(std::string_view source,
+                       std::unordered_set<std::string> defines = {});
+
+#endif // !PREPROCESS_HPP_
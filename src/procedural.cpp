@@ -0,0 +1,322 @@
+#include "procedural.hpp"
+#include "materials/dielectric.hpp"
+#include "materials/lambertian.hpp"
+#include "materials/metal.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+// floor of the slab and the ground plane, below the camera at the origin
+constexpr float GROUND = -1.0f;
+// distance from the camera to the first row of the slab
+constexpr float SLAB_START = 3.0f;
+
+// high bits of a stream index, so spheres, clusters and palette entries each
+// get their own rng streams
+enum class Stream : uint64_t {
+  Sphere = 0,
+  Cluster = 1,
+  Palette = 2,
+};
+
+uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+
+// splitmix64 with a state derived from (seed, stream), so any element can be
+// generated without generating the ones before it
+class Rng {
+public:
+  Rng(uint64_t seed, Stream stream, uint64_t index)
+      : state{mix64(seed ^ mix64((static_cast<uint64_t>(stream) << 56) ^
+                                 index))} {}
+
+  uint64_t next() {
+    state += 0x9e3779b97f4a7c15ull;
+    return mix64(state);
+  }
+
+  // [0, 1) with 24 bits, exactly representable as a float
+  float uniform() { return static_cast<float>(next() >> 40) * 0x1.0p-24f; }
+
+  float uniform(float min, float max) { return min + (max - min) * uniform(); }
+
+  // irwin-hall approximation of a normal distribution with unit variance,
+  // plain arithmetic so it's bit identical everywhere
+  float gaussian() {
+    return (uniform() + uniform() + uniform() - 1.5f) * 2.0f;
+  }
+
+private:
+  uint64_t state;
+};
+
+// smallest k with k^power >= n, integer only for the same reason
+uint32_t int_root(uint64_t n, uint32_t power) {
+  uint64_t k = 1;
+  auto raised = [power](uint64_t value) {
+    uint64_t result = 1;
+    for (uint32_t i = 0; i < power; i++) {
+      result *= value;
+    }
+    return result;
+  };
+  while (raised(k) < n) {
+    k++;
+  }
+  return static_cast<uint32_t>(k);
+}
+
+// cells of a slab that sits on the ground in front of the camera, wider than
+// it is tall so most of it stays in view
+class Grid {
+public:
+  Grid(uint64_t cells, float cell_size) : cell_size{cell_size} {
+    layers = std::max<uint32_t>(1, int_root(cells, 3) / 4);
+    uint64_t per_layer = (cells + layers - 1) / layers;
+    columns = int_root(per_layer, 2);
+    rows = static_cast<uint32_t>((per_layer + columns - 1) / columns);
+  }
+
+  glm::vec3 center(uint64_t cell) const {
+    auto column = static_cast<float>(cell % columns);
+    auto row = static_cast<float>(cell / columns % rows);
+    auto layer = static_cast<float>(cell / (uint64_t{columns} * rows));
+    return glm::vec3{
+        (column - static_cast<float>(columns - 1) * 0.5f) * cell_size,
+        GROUND + (layer + 0.5f) * cell_size,
+        -SLAB_START - row * cell_size,
+    };
+  }
+
+  glm::vec3 min() const {
+    return glm::vec3{-static_cast<float>(columns) * 0.5f * cell_size, GROUND,
+                     -SLAB_START - static_cast<float>(rows) * cell_size};
+  }
+
+  glm::vec3 max() const {
+    return glm::vec3{static_cast<float>(columns) * 0.5f * cell_size,
+                     GROUND + static_cast<float>(layers) * cell_size,
+                     -SLAB_START};
+  }
+
+private:
+  float cell_size;
+  uint32_t layers;
+  uint32_t columns;
+  uint32_t rows;
+};
+
+// material indices per type, picked from by weight
+class Palette {
+public:
+  Palette(Scene &scene, const ProceduralSettings &settings) : mix{settings.mix} {
+    if (mix.lambertian < 0.0f || mix.metal < 0.0f || mix.dielectric < 0.0f ||
+        mix.lambertian + mix.metal + mix.dielectric <= 0.0f) {
+      throw std::runtime_error{
+          "material mix weights must be positive and not all zero"};
+    }
+    // only types that can be picked go in the material table, so a single
+    // material type scene gets a shader variant without the others. nests
+    // always need glass for their shells
+    bool glass = mix.dielectric > 0.0f ||
+                 settings.distribution == Distribution::Nested;
+    for (uint32_t i = 0; i < settings.palette; i++) {
+      Rng rng{settings.seed, Stream::Palette, i};
+      glm::vec3 albedo{rng.uniform(0.1f, 0.9f), rng.uniform(0.1f, 0.9f),
+                       rng.uniform(0.1f, 0.9f)};
+      glm::vec3 tint{rng.uniform(0.5f, 1.0f), rng.uniform(0.5f, 1.0f),
+                     rng.uniform(0.5f, 1.0f)};
+      float fuzz = rng.uniform(0.0f, 0.5f);
+      float ir = rng.uniform(1.3f, 1.9f);
+      if (mix.lambertian > 0.0f) {
+        lambertians.push_back(scene.add_material(lambertian(albedo)));
+      }
+      if (mix.metal > 0.0f) {
+        metals.push_back(scene.add_material(metal(tint, fuzz)));
+      }
+      if (glass) {
+        dielectrics.push_back(scene.add_material(dielectric(ir)));
+      }
+    }
+  }
+
+  uint32_t pick(Rng &rng) const {
+    float total = mix.lambertian + mix.metal + mix.dielectric;
+    float kind = rng.uniform() * total;
+    if (kind < mix.lambertian) {
+      return pick_from(lambertians, rng);
+    }
+    if (kind < mix.lambertian + mix.metal) {
+      return pick_from(metals, rng);
+    }
+    return pick_dielectric(rng);
+  }
+
+  uint32_t pick_dielectric(Rng &rng) const {
+    return pick_from(dielectrics, rng);
+  }
+
+private:
+  static uint32_t pick_from(const std::vector<uint32_t> &materials, Rng &rng) {
+    return materials[rng.next() % materials.size()];
+  }
+
+  MaterialMix mix;
+  std::vector<uint32_t> lambertians;
+  std::vector<uint32_t> metals;
+  std::vector<uint32_t> dielectrics;
+};
+
+// radius relative to the cell size, see ProceduralSettings::overlap
+float cell_radius(float overlap) { return 0.4f + 0.6f * overlap; }
+
+void generate_uniform(Scene &scene, const ProceduralSettings &settings,
+                      const Palette &palette) {
+  Grid grid{settings.count, 1.0f};
+  float max_radius = cell_radius(settings.overlap);
+  for (uint32_t i = 0; i < settings.count; i++) {
+    Rng rng{settings.seed, Stream::Sphere, i};
+    float radius = max_radius * rng.uniform(0.75f, 1.0f);
+    // only jitter as far as the sphere stays inside its cell
+    float jitter = std::max(0.0f, 0.5f - radius);
+    glm::vec3 offset{rng.uniform(-jitter, jitter), rng.uniform(-jitter, jitter),
+                     rng.uniform(-jitter, jitter)};
+    scene.add_sphere(grid.center(i) + offset, radius, palette.pick(rng));
+  }
+}
+
+void generate_clustered(Scene &scene, const ProceduralSettings &settings,
+                        const Palette &palette) {
+  constexpr uint32_t SPHERES_PER_CLUSTER = 1000;
+  uint32_t clusters = std::max(1u, settings.count / SPHERES_PER_CLUSTER);
+  // the same slab as the uniform distribution, so density is what changes
+  Grid grid{settings.count, 1.0f};
+  glm::vec3 min = grid.min();
+  glm::vec3 max = grid.max();
+  std::vector<glm::vec3> centers;
+  centers.reserve(clusters);
+  for (uint32_t k = 0; k < clusters; k++) {
+    Rng rng{settings.seed, Stream::Cluster, k};
+    centers.emplace_back(rng.uniform(min.x, max.x), rng.uniform(min.y, max.y),
+                         rng.uniform(min.z, max.z));
+  }
+
+  float spread =
+      0.5f * static_cast<float>(int_root(settings.count / clusters, 3));
+  float max_radius = cell_radius(settings.overlap);
+  for (uint32_t i = 0; i < settings.count; i++) {
+    Rng rng{settings.seed, Stream::Sphere, i};
+    float radius = max_radius * rng.uniform(0.75f, 1.0f);
+    glm::vec3 center = centers[i % clusters];
+    center.x += rng.gaussian() * spread;
+    center.y = std::max(GROUND + radius, center.y + rng.gaussian() * spread);
+    center.z = std::min(-SLAB_START, center.z + rng.gaussian() * spread);
+    scene.add_sphere(center, radius, palette.pick(rng));
+  }
+}
+
+void generate_nested(Scene &scene, const ProceduralSettings &settings,
+                     const Palette &palette) {
+  // outer glass, the hollow inside it (negative radius flips the normals),
+  // an inner glass ball and a core in the material mix
+  constexpr std::array<float, 4> SHELLS{1.0f, -0.9f, 0.6f, 0.35f};
+  constexpr uint32_t SHELL_COUNT = static_cast<uint32_t>(SHELLS.size());
+  constexpr float NEST_SIZE = 2.0f;
+  uint32_t nests = (settings.count + SHELL_COUNT - 1) / SHELL_COUNT;
+  Grid grid{nests, NEST_SIZE};
+  float outer = NEST_SIZE * cell_radius(settings.overlap);
+  for (uint32_t i = 0; i < settings.count; i++) {
+    uint32_t nest = i / SHELL_COUNT;
+    uint32_t shell = i % SHELL_COUNT;
+    // shells of a nest share the nest's stream so they stay concentric
+    Rng rng{settings.seed, Stream::Sphere, nest};
+    float radius = outer * rng.uniform(0.75f, 1.0f);
+    uint32_t glass = palette.pick_dielectric(rng);
+    uint32_t core = palette.pick(rng);
+    scene.add_sphere(grid.center(nest), radius * SHELLS[shell],
+                     shell + 1 < SHELL_COUNT ? glass : core);
+  }
+}
+} // namespace
+
+Distribution distribution_from_name(const std::string &name) {
+  if (name == "uniform") {
+    return Distribution::Uniform;
+  }
+  if (name == "clustered") {
+    return Distribution::Clustered;
+  }
+  if (name == "nested") {
+    return Distribution::Nested;
+  }
+  throw std::runtime_error{"unknown distribution: " + name};
+}
+
+MaterialMix material_mix_from_string(const std::string &mix) {
+  MaterialMix result{.lambertian = 0.0f, .metal = 0.0f, .dielectric = 0.0f};
+  std::istringstream stream{mix};
+  std::string entry;
+  while (std::getline(stream, entry, ',')) {
+    auto equals = entry.find('=');
+    if (equals == std::string::npos) {
+      throw std::runtime_error{"expected type=weight in material mix: " +
+                               entry};
+    }
+    auto type = entry.substr(0, equals);
+    float weight = std::stof(entry.substr(equals + 1));
+    if (type == "lambertian") {
+      result.lambertian = weight;
+    } else if (type == "metal") {
+      result.metal = weight;
+    } else if (type == "dielectric") {
+      result.dielectric = weight;
+    } else {
+      throw std::runtime_error{"unknown material type in mix: " + type};
+    }
+  }
+  return result;
+}
+
+Scene procedural_scene(const ProceduralSettings &settings) {
+  if (settings.count == 0 || settings.palette == 0) {
+    throw std::runtime_error{"sphere count and palette size must be positive"};
+  }
+  if (settings.overlap < 0.0f || settings.overlap > 1.0f) {
+    throw std::runtime_error{"overlap must be between 0 and 1"};
+  }
+
+  Scene scene;
+  Palette palette{scene, settings};
+  // from the mix as well, so it doesn't add a material type of its own
+  Rng ground_rng{settings.seed, Stream::Palette, settings.palette};
+  uint32_t ground = palette.pick(ground_rng);
+  scene.spheres().reserve(settings.count);
+  switch (settings.distribution) {
+  case Distribution::Uniform:
+    generate_uniform(scene, settings, palette);
+    break;
+  case Distribution::Clustered:
+    generate_clustered(scene, settings, palette);
+    break;
+  case Distribution::Nested:
+    generate_nested(scene, settings, palette);
+    break;
+  }
+  scene.add_plane(glm::vec3{0.0f, GROUND, 0.0f}, glm::vec3{0.0f, -1.0f, 0.0f},
+                  ground);
+  return scene;
+}
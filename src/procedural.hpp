@@ -0,0 +1,48 @@
+#ifndef PROCEDURAL_HPP_
+#define PROCEDURAL_HPP_
+
+#include "scene.hpp"
+
+#include <cstdint>
+#include <string>
+
+enum class Distribution {
+  // jittered grid filling a slab in front of the camera
+  Uniform,
+  // gaussian-ish blobs scattered over the same slab
+  Clustered,
+  // glass shells around a solid core, four spheres per nest
+  Nested,
+};
+
+Distribution distribution_from_name(const std::string &name);
+
+// relative weights of each material type, they don't need to sum to 1
+struct MaterialMix {
+  float lambertian = 0.6f;
+  float metal = 0.3f;
+  float dielectric = 0.1f;
+};
+
+// parses "lambertian=0.6,metal=0.3,dielectric=0.1", missing types get 0
+MaterialMix material_mix_from_string(const std::string &mix);
+
+struct ProceduralSettings {
+  // spheres generated, a ground plane is always added on top
+  uint32_t count = 1000;
+  Distribution distribution = Distribution::Uniform;
+  MaterialMix mix;
+  // 0 keeps every sphere clear of its neighbours, 1 grows radii to a full
+  // grid cell so neighbours intersect
+  float overlap = 0.0f;
+  // distinct materials per material type
+  uint32_t palette = 16;
+  uint64_t seed = 1;
+};
+
+// the same settings always give the same scene, on any platform: sphere i
+// only depends on the seed and i, no libm or <random> distributions are
+// involved and procedural.cpp is built without fma contraction
+Scene procedural_scene(const ProceduralSettings &settings);
+
+#endif // !PROCEDURAL_HPP_
@@ -1,21 +1,33 @@
 #include "render.hpp"
+#include "preprocess.hpp"
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 #define EXPLICIT_UNUSED(ident) (void)ident
 
 namespace logging {
-void Error(WGPUErrorType type, const char *msg, void *) {
+// errors are recorded rather than aborting, the renderer throws them once it
+// gets control back (see Renderer::check_device)
+void Error(WGPUErrorType type, const char *msg, void *userdata) {
+  auto status = static_cast<DeviceStatus *>(userdata);
   switch (type) {
   case WGPUErrorType_OutOfMemory:
     std::cerr << "[Error] Out Of Memory: " << msg << '\n';
-    abort();
+    status->error = std::string{"out of memory: "} + msg;
+    break;
   case WGPUErrorType_Validation:
     std::cerr << "[Error Validation: " << msg << '\n';
-    abort();
+    status->error = std::string{"validation error: "} + msg;
+    break;
   case WGPUErrorType_NoError:
   case WGPUErrorType_Unknown:
   case WGPUErrorType_DeviceLost:
@@ -26,7 +38,8 @@ void Error(WGPUErrorType type, const char *msg, void *) {
   }
 }
 
-void DeviceLost(WGPUDeviceLostReason reason, char const *msg, void *) {
+void DeviceLost(WGPUDeviceLostReason reason, char const *msg, void *userdata) {
+  static_cast<DeviceStatus *>(userdata)->lost = true;
   std::cerr << "[Device Lost]: ";
   switch (reason) {
   case WGPUDeviceLostReason_Undefined:
@@ -107,40 +120,58 @@ Renderer::request_adapter(const wgpu::RequestAdapterOptions &options) const {
 }
 
 wgpu::Device Renderer::setup_device(const wgpu::Adapter adapter) const {
-  wgpu::Device device = adapter.CreateDevice();
+  // large scenes easily go past the default 128MiB storage binding limit, so
+  // ask for whatever the adapter supports
+  wgpu::SupportedLimits supported;
+  adapter.GetLimits(&supported);
+  wgpu::RequiredLimits required;
+  required.limits.maxStorageBufferBindingSize =
+      supported.limits.maxStorageBufferBindingSize;
+  required.limits.maxBufferSize = supported.limits.maxBufferSize;
+  wgpu::DeviceDescriptor deviceDesc;
+  deviceDesc.requiredLimits = &required;
+
+  wgpu::Device device = adapter.CreateDevice(&deviceDesc);
   device.SetLabel("Primary Device");
-  device.SetUncapturedErrorCallback(logging::Error, nullptr);
-  device.SetDeviceLostCallback(logging::DeviceLost, nullptr);
+  device.SetUncapturedErrorCallback(logging::Error, status.get());
+  device.SetDeviceLostCallback(logging::DeviceLost, status.get());
   device.SetLoggingCallback(logging::Logging, nullptr);
   return device;
 }
 
-Renderer::Renderer(std::string source)
-    : source{source}, instance{wgpu::CreateInstance()} {
+Renderer::Renderer(std::string source, std::string resolve_source,
+                   bool fallback_adapter)
+    : source{source}, resolve_source{resolve_source},
+      instance{wgpu::CreateInstance()},
+      status{std::make_unique<DeviceStatus>()} {
   // Get Adapter
   wgpu::RequestAdapterOptions adapterOpts{
       .powerPreference = wgpu::PowerPreference::HighPerformance,
+      .forceFallbackAdapter = fallback_adapter,
   };
   adapter = request_adapter(adapterOpts);
   device = setup_device(adapter);
+  setup_layouts();
+  setup_resolve_pipeline();
+}
+
+MappedImage::MappedImage(wgpu::Buffer buffer, ImageView view)
+    : buffer{std::move(buffer)}, image{view} {}
+
+MappedImage::~MappedImage() {
+  if (buffer) {
+    buffer.Unmap();
+  }
 }
 
+const ImageView &MappedImage::view() const { return image; }
+
 wgpu::AdapterProperties Renderer::adapter_properties() const {
   wgpu::AdapterProperties adapterProps;
   adapter.GetProperties(&adapterProps);
   return adapterProps;
 }
 
-uint32_t paddedBytesPerRow(uint32_t width) {
-  // This is defined inside of DAWN and the WebGPU spec and isn't reasonable to
-  // pull from them
-  constexpr uint32_t BYTES_PER_ROW_ALIGN = 256;
-  uint32_t bytesPerRow = width * 4;
-  uint32_t padding = (BYTES_PER_ROW_ALIGN - bytesPerRow % BYTES_PER_ROW_ALIGN) %
-                     BYTES_PER_ROW_ALIGN;
-  return bytesPerRow + padding;
-}
-
 glm::uvec2 calculateWorkgroups(glm::uvec2 size) {
   // this has to be hardcoded because it is also in compute.wgsl
   constexpr glm::uvec2 WORKGROUP_SIZE{16, 16};
@@ -148,151 +179,199 @@ glm::uvec2 calculateWorkgroups(glm::uvec2 size) {
 }
 
 wgpu::ShaderModule create_shader(wgpu::Device device,
-                                 const std::string &source) {
+                                 const std::string &source,
+                                 const char *label = "compute shader module") {
   wgpu::ShaderModuleWGSLDescriptor wgslDesc;
   wgslDesc.code = source.c_str();
   wgpu::ShaderModuleDescriptor desc{
       .nextInChain = &wgslDesc,
-      .label = "compute shader module",
+      .label = label,
   };
   return device.CreateShaderModule(&desc);
 }
 
+// matches ConfigUniform in compute.wgsl
 struct RenderConfig {
   uint32_t samples_per_pixel;
   uint32_t max_depth;
+  uint32_t pass_index;
+  uint32_t width;
+  uint32_t height;
+  uint32_t sphere_count;
+  uint32_t plane_count;
 };
 
-std::vector<uint8_t> Renderer::render_scene(Scene scene, glm::uvec2 size,
-                                            uint32_t samples,
-                                            uint32_t max_depth) {
-  std::string sourceWithScene{scene.generate() + source};
-  auto computeShader = create_shader(device, sourceWithScene);
+// matches ResolveUniform in resolve.wgsl
+struct ResolveConfig {
+  uint32_t width;
+  uint32_t height;
+  float samples;
+  float exposure;
+  Tonemap tonemap;
+  uint32_t srgb;
+  uint32_t dither;
+  PixelFormat format;
+};
 
-  wgpu::ComputePipelineDescriptor compPipeDesc{
-      .label = "Raytrace pipeline",
-      .compute =
-          {
-              .module = computeShader,
-              .entryPoint = "main",
-          },
-  };
-  auto computePipeline = device.CreateComputePipeline(&compPipeDesc);
-
-  wgpu::Extent3D outputExtent{size.x, size.y};
-  wgpu::TextureDescriptor outputTextureDesc{
-      .label = "Output texture",
-      .usage = wgpu::TextureUsage::CopySrc | wgpu::TextureUsage::StorageBinding,
-      .dimension = wgpu::TextureDimension::e2D,
-      .size = outputExtent,
-      .format = wgpu::TextureFormat::RGBA8Unorm,
-      .mipLevelCount = 1,
-      .sampleCount = 1,
-  };
-  auto outputTexture = device.CreateTexture(&outputTextureDesc);
-  std::array<wgpu::BindGroupEntry, 1> computeOutputBindGroupDescEntries{
-      wgpu::BindGroupEntry{
-          .binding = 0,
-          .textureView = outputTexture.CreateView(),
-      },
-  };
-  wgpu::BindGroupDescriptor computeOutputBindGroupDesc{
-      .label = "Compute Output Bind Group",
-      .layout = computePipeline.GetBindGroupLayout(0),
-      .entryCount = computeOutputBindGroupDescEntries.size(),
-      .entries = computeOutputBindGroupDescEntries.data(),
-  };
-  auto computeOutputBindGroup =
-      device.CreateBindGroup(&computeOutputBindGroupDesc);
-
-  std::array<wgpu::BindGroupLayoutEntry, 1> configBindGroupLayoutEntries{
-      wgpu::BindGroupLayoutEntry{
-          .binding = 0,
-          .visibility = wgpu::ShaderStage::Compute,
-          .buffer =
-              wgpu::BufferBindingLayout{
-                  .type = wgpu::BufferBindingType::Uniform,
-              },
-      },
-  };
-  wgpu::BindGroupLayoutDescriptor configBindGroupLayoutDesc{
-      .label = "Config Bind Group Layout",
-      .entryCount = configBindGroupLayoutEntries.size(),
-      .entries = configBindGroupLayoutEntries.data(),
-  };
-  auto configBindGroupLayout =
-      device.CreateBindGroupLayout(&configBindGroupLayoutDesc);
+// invocations of the resolve pass and the words of output they write
+struct ResolveOutput {
+  uint64_t invocations;
+  uint64_t words;
+};
 
-  RenderConfig config{
-      .samples_per_pixel = samples,
-      .max_depth = max_depth,
-  };
-  wgpu::BufferDescriptor configBufferDesc{
-      .label = "Config Buffer",
+ResolveOutput resolve_output(PixelFormat format, uint64_t pixels) {
+  switch (format) {
+  case PixelFormat::RGB8: {
+    // 4 pixels fill exactly 3 words
+    uint64_t groups = (pixels + 3) / 4;
+    return {groups, groups * 3};
+  }
+  case PixelFormat::RGBA16F:
+    return {pixels, pixels * 2};
+  case PixelFormat::RGB32F:
+    return {pixels, pixels * 3};
+  }
+  throw std::runtime_error{"unknown pixel format!"};
+}
+
+glm::uvec2 calculateResolveWorkgroups(uint64_t invocations) {
+  // this has to be hardcoded because it is also in resolve.wgsl
+  constexpr uint64_t WORKGROUP_SIZE = 256;
+  constexpr uint64_t MAX_WORKGROUPS = 65535;
+  uint64_t groups = (invocations + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+  uint64_t rows = (groups + MAX_WORKGROUPS - 1) / MAX_WORKGROUPS;
+  return {static_cast<uint32_t>(std::min(groups, MAX_WORKGROUPS)),
+          static_cast<uint32_t>(rows)};
+}
+
+wgpu::Buffer create_uniform_buffer(wgpu::Device device, const char *label,
+                                   const void *data, uint64_t size) {
+  wgpu::BufferDescriptor bufferDesc{
+      .label = label,
       .usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst,
-      .size = sizeof(RenderConfig),
+      .size = size,
       .mappedAtCreation = true,
   };
-  auto configBuffer = device.CreateBuffer(&configBufferDesc);
-  *static_cast<RenderConfig *>(configBuffer.GetMappedRange()) = config;
-  configBuffer.Unmap();
-
-  std::array<wgpu::BindGroupEntry, 1> configBindGroupEntries{
-      wgpu::BindGroupEntry{
-          .binding = 0,
-          .buffer = configBuffer,
-      },
+  auto buffer = device.CreateBuffer(&bufferDesc);
+  std::memcpy(buffer.GetMappedRange(), data, size);
+  buffer.Unmap();
+  return buffer;
+}
+
+wgpu::BindGroup create_bind_group(wgpu::Device device, const char *label,
+                                  wgpu::BindGroupLayout layout,
+                                  const std::vector<wgpu::Buffer> &buffers) {
+  std::vector<wgpu::BindGroupEntry> entries;
+  for (uint32_t i = 0; i < buffers.size(); i++) {
+    entries.push_back(wgpu::BindGroupEntry{
+        .binding = i,
+        .buffer = buffers[i],
+    });
+  }
+  wgpu::BindGroupDescriptor desc{
+      .label = label,
+      .layout = layout,
+      .entryCount = entries.size(),
+      .entries = entries.data(),
   };
-  wgpu::BindGroupDescriptor configBindGroupDesc{
-      .label = "Config Bind Group",
-      .layout = computePipeline.GetBindGroupLayout(1),
-      .entryCount = configBindGroupEntries.size(),
-      .entries = configBindGroupEntries.data(),
+  return device.CreateBindGroup(&desc);
+}
+
+wgpu::BindGroupLayoutEntry buffer_layout_entry(uint32_t binding,
+                                               wgpu::BufferBindingType type) {
+  return wgpu::BindGroupLayoutEntry{
+      .binding = binding,
+      .visibility = wgpu::ShaderStage::Compute,
+      .buffer =
+          {
+              .type = type,
+          },
   };
-  auto configBindGroup = device.CreateBindGroup(&configBindGroupDesc);
+}
 
-  wgpu::CommandEncoderDescriptor encDesc{
-      .label = "Compute Encoder",
+wgpu::BindGroupLayout create_bind_group_layout(
+    wgpu::Device device, const char *label,
+    const std::vector<wgpu::BindGroupLayoutEntry> &entries) {
+  wgpu::BindGroupLayoutDescriptor desc{
+      .label = label,
+      .entryCount = entries.size(),
+      .entries = entries.data(),
   };
-  auto computeEncoder = device.CreateCommandEncoder(&encDesc);
+  return device.CreateBindGroupLayout(&desc);
+}
 
-  {
-    wgpu::ComputePassDescriptor passDesc{
-        .label = "Compute Pass",
-    };
-    auto computePass = computeEncoder.BeginComputePass(&passDesc);
-    computePass.SetPipeline(computePipeline);
-    computePass.SetBindGroup(0, computeOutputBindGroup);
-    computePass.SetBindGroup(1, configBindGroup);
-    glm::uvec2 workgroups = calculateWorkgroups(size);
-    computePass.DispatchWorkgroups(workgroups.x, workgroups.y);
-    computePass.End();
+void Renderer::setup_layouts() {
+  accumulation_layout = create_bind_group_layout(
+      device, "Accumulation Bind Group Layout",
+      {buffer_layout_entry(0, wgpu::BufferBindingType::Storage)});
+  config_layout = create_bind_group_layout(
+      device, "Config Bind Group Layout",
+      {buffer_layout_entry(0, wgpu::BufferBindingType::Uniform)});
+  std::vector<wgpu::BindGroupLayoutEntry> sceneEntries;
+  for (uint32_t i = 0; i < SCENE_BUFFER_COUNT; i++) {
+    sceneEntries.push_back(
+        buffer_layout_entry(i, wgpu::BufferBindingType::ReadOnlyStorage));
   }
+  scene_layout = create_bind_group_layout(device, "Scene Bind Group Layout",
+                                          sceneEntries);
 
-  uint32_t bytesPerRow = paddedBytesPerRow(size.x);
-  wgpu::BufferDescriptor outputBufferDesc{
-      .label = "Output Buffer",
-      .usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::MapRead,
-      .size = bytesPerRow * size.y,
+  // explicit rather than automatic so the layout (and the bind groups made
+  // from it) don't depend on which bindings a generated scene happens to use
+  std::array<wgpu::BindGroupLayout, 3> layouts{accumulation_layout,
+                                               config_layout, scene_layout};
+  wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{
+      .label = "Raytrace Pipeline Layout",
+      .bindGroupLayoutCount = layouts.size(),
+      .bindGroupLayouts = layouts.data(),
   };
-  auto outputBuffer = device.CreateBuffer(&outputBufferDesc);
-  wgpu::ImageCopyTexture texSrc{
-      .texture = outputTexture,
+  pipeline_layout = device.CreatePipelineLayout(&pipelineLayoutDesc);
+}
+
+void Renderer::setup_resolve_pipeline() {
+  resolve_layout = create_bind_group_layout(
+      device, "Resolve Bind Group Layout",
+      {
+          buffer_layout_entry(0, wgpu::BufferBindingType::ReadOnlyStorage),
+          buffer_layout_entry(1, wgpu::BufferBindingType::Storage),
+          buffer_layout_entry(2, wgpu::BufferBindingType::Uniform),
+      });
+  wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{
+      .label = "Resolve Pipeline Layout",
+      .bindGroupLayoutCount = 1,
+      .bindGroupLayouts = &resolve_layout,
   };
-  wgpu::ImageCopyBuffer bufDst{
-      .layout =
+  auto resolvePipelineLayout = device.CreatePipelineLayout(&pipelineLayoutDesc);
+
+  wgpu::ComputePipelineDescriptor resolvePipeDesc{
+      .label = "Resolve pipeline",
+      .layout = resolvePipelineLayout,
+      .compute =
           {
-              .bytesPerRow = bytesPerRow,
+              .module = create_shader(device, resolve_source,
+                                      "resolve shader module"),
+              .entryPoint = "main",
           },
-      .buffer = outputBuffer,
   };
-  computeEncoder.CopyTextureToBuffer(&texSrc, &bufDst, &outputExtent);
+  resolve_pipeline = device.CreateComputePipeline(&resolvePipeDesc);
+}
 
-  auto commands = computeEncoder.Finish();
-  device.GetQueue().Submit(1, &commands);
+void Renderer::check_device() {
+  if (status->lost) {
+    throw std::runtime_error{"device lost"};
+  }
+  if (!status->error.empty()) {
+    auto error = std::move(status->error);
+    status->error.clear();
+    // the pipeline may be what failed, make sure it's rebuilt next time
+    pipelines.clear();
+    pipeline = nullptr;
+    throw std::runtime_error{error};
+  }
+}
 
-  outputBuffer.MapAsync(
-      wgpu::MapMode::Read, 0, bytesPerRow * size.y,
+void Renderer::wait_for_map(wgpu::Buffer &buffer, uint64_t size) {
+  buffer.MapAsync(
+      wgpu::MapMode::Read, 0, size,
       [](WGPUBufferMapAsyncStatus cStatus, void *userdata) {
         EXPLICIT_UNUSED(userdata);
         wgpu::BufferMapAsyncStatus status{cStatus};
@@ -302,28 +381,329 @@ std::vector<uint8_t> Renderer::render_scene(Scene scene, glm::uvec2 size,
       },
       nullptr);
 
-  std::cerr << "waiting on render..." << '\n';
-
   // so there seems to be no way to poll the dawn device and just wait until
   // the gpu has finished it's work so we just check when the buffer is
   // successfully mapped (guaranteed to be after the pipeline) and then
   // call it a day from there.
-  const uint8_t *paddedOutput;
-  bool complete = false;
-  while (!complete) {
+  while (buffer.GetMapState() != wgpu::BufferMapState::Mapped) {
+    device.Tick();
+    check_device();
+  }
+}
+
+Checkpoint Renderer::read_checkpoint(const wgpu::Buffer &accumulation,
+                                     const Checkpoint &state) {
+  uint64_t size = accumulation.GetSize();
+  wgpu::BufferDescriptor readbackDesc{
+      .label = "Checkpoint Readback Buffer",
+      .usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::MapRead,
+      .size = size,
+  };
+  auto readback = device.CreateBuffer(&readbackDesc);
+  auto encoder = device.CreateCommandEncoder();
+  encoder.CopyBufferToBuffer(accumulation, 0, readback, 0, size);
+  auto commands = encoder.Finish();
+  device.GetQueue().Submit(1, &commands);
+  wait_for_map(readback, size);
+
+  Checkpoint checkpoint{state};
+  auto mapped =
+      static_cast<const glm::vec4 *>(readback.GetConstMappedRange(0, size));
+  checkpoint.accumulation.assign(mapped, mapped + size / sizeof(glm::vec4));
+  readback.Unmap();
+  return checkpoint;
+}
+
+void Renderer::update_pipeline(const SceneFeatures &features,
+                               const std::string &scene_source) {
+  auto cached = pipelines.find(features.mask());
+  stats.recompiled = cached == pipelines.end();
+  if (!stats.recompiled) {
+    pipeline = cached->second;
+    stats.compile = {};
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::string sourceWithScene = preprocess(scene_source + source);
+  auto computeShader = create_shader(device, sourceWithScene);
+
+  wgpu::ComputePipelineDescriptor compPipeDesc{
+      .label = "Raytrace pipeline",
+      .layout = pipeline_layout,
+      .compute =
+          {
+              .module = computeShader,
+              .entryPoint = "main",
+          },
+  };
+  pipeline = device.CreateComputePipeline(&compPipeDesc);
+  pipelines.emplace(features.mask(), pipeline);
+  stats.compile = std::chrono::steady_clock::now() - start;
+}
+
+bool Renderer::upload_array(wgpu::Buffer &buffer, const char *label,
+                            const void *data, size_t bytes) {
+  // bindings can't be empty and must fit at least one element of the largest
+  // array type (Material). the padding, and whatever a smaller scene left
+  // behind in a reused buffer, is never read as the generated loops stop at
+  // the primitive counts in ConfigUniform rather than arrayLength
+  constexpr uint64_t MIN_BINDING_SIZE = sizeof(Material);
+  uint64_t size = std::max<uint64_t>(bytes, MIN_BINDING_SIZE);
+  if (buffer && buffer.GetSize() == size) {
+    if (bytes > 0) {
+      device.GetQueue().WriteBuffer(buffer, 0, data, bytes);
+    }
+    return false;
+  }
+
+  wgpu::BufferDescriptor bufferDesc{
+      .label = label,
+      .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+      .size = size,
+      .mappedAtCreation = true,
+  };
+  buffer = device.CreateBuffer(&bufferDesc);
+  if (bytes > 0) {
+    std::memcpy(buffer.GetMappedRange(), data, bytes);
+  }
+  buffer.Unmap();
+  return true;
+}
+
+template <typename T>
+size_t byte_size(const std::vector<T> &column) {
+  return column.size() * sizeof(T);
+}
+
+void Renderer::update_scene(const Scene &scene) {
+  const auto &materials = scene.materials().materials();
+  const auto &spheres = scene.spheres();
+  const auto &planes = scene.planes();
+
+  // one copy per column, in the binding order of group 2 in compute.wgsl
+  bool recreated = false;
+  recreated |= upload_array(scene_buffers[0], "Materials Buffer",
+                            materials.data(), byte_size(materials));
+  recreated |= upload_array(scene_buffers[1], "Sphere Centers Buffer",
+                            spheres.centers.data(), byte_size(spheres.centers));
+  recreated |= upload_array(scene_buffers[2], "Sphere Radii Buffer",
+                            spheres.radii.data(), byte_size(spheres.radii));
+  recreated |=
+      upload_array(scene_buffers[3], "Sphere Materials Buffer",
+                   spheres.materials.data(), byte_size(spheres.materials));
+  recreated |= upload_array(scene_buffers[4], "Plane Points Buffer",
+                            planes.points.data(), byte_size(planes.points));
+  recreated |= upload_array(scene_buffers[5], "Plane Normals Buffer",
+                            planes.normals.data(), byte_size(planes.normals));
+  recreated |=
+      upload_array(scene_buffers[6], "Plane Materials Buffer",
+                   planes.materials.data(), byte_size(planes.materials));
+  if (!recreated && scene_bind_group) {
+    return;
+  }
+
+  std::array<wgpu::BindGroupEntry, SCENE_BUFFER_COUNT> sceneBindGroupEntries;
+  for (uint32_t i = 0; i < SCENE_BUFFER_COUNT; i++) {
+    sceneBindGroupEntries[i] = wgpu::BindGroupEntry{
+        .binding = i,
+        .buffer = scene_buffers[i],
+    };
+  }
+  wgpu::BindGroupDescriptor sceneBindGroupDesc{
+      .label = "Scene Bind Group",
+      .layout = scene_layout,
+      .entryCount = sceneBindGroupEntries.size(),
+      .entries = sceneBindGroupEntries.data(),
+  };
+  scene_bind_group = device.CreateBindGroup(&sceneBindGroupDesc);
+}
+
+const RenderStats &Renderer::last_stats() const { return stats; }
+
+MappedImage Renderer::render_scene(const Scene &scene,
+                                   const RenderSettings &settings,
+                                   const Checkpoint *resume) {
+  const glm::uvec2 size = settings.size;
+  const uint64_t pixels = uint64_t{size.x} * size.y;
+  if (settings.samples_per_pass == 0) {
+    throw std::runtime_error{"samples per pass must be at least 1"};
+  }
+
+  Checkpoint state{
+      .width = size.x,
+      .height = size.y,
+      .max_depth = settings.max_depth,
+      .scene_hash = hash_scene(scene),
+      .passes = {{settings.first_pass, settings.first_pass}},
+      .samples = 0,
+  };
+  if (resume) {
+    if (resume->width != state.width || resume->height != state.height ||
+        resume->max_depth != state.max_depth ||
+        resume->scene_hash != state.scene_hash ||
+        resume->accumulation.size() != pixels || resume->passes.empty()) {
+      throw std::runtime_error{
+          "checkpoint doesn't match the scene and settings being rendered"};
+    }
+    state.passes = resume->passes;
+    state.samples = resume->samples;
+  }
+
+  auto codegenStart = std::chrono::steady_clock::now();
+  auto features = scene.features();
+  if (!settings.specialize) {
+    features = features.with_all_materials();
+  }
+  auto sceneSource = scene.generate(features);
+  stats.codegen = std::chrono::steady_clock::now() - codegenStart;
+  update_pipeline(features, sceneSource);
+
+  auto uploadStart = std::chrono::steady_clock::now();
+  update_scene(scene);
+  stats.upload = std::chrono::steady_clock::now() - uploadStart;
+
+  // buffers mapped at creation start zeroed, so only a resume needs a copy
+  wgpu::BufferDescriptor accumulationDesc{
+      .label = "Accumulation Buffer",
+      .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc,
+      .size = pixels * sizeof(glm::vec4),
+      .mappedAtCreation = true,
+  };
+  auto accumulation = device.CreateBuffer(&accumulationDesc);
+  if (resume) {
+    std::memcpy(accumulation.GetMappedRange(), resume->accumulation.data(),
+                accumulationDesc.size);
+  }
+  accumulation.Unmap();
+  auto accumulationBindGroup = create_bind_group(
+      device, "Accumulation Bind Group", accumulation_layout, {accumulation});
+
+  RenderConfig config{
+      .samples_per_pixel = 0,
+      .max_depth = settings.max_depth,
+      .pass_index = 0,
+      .width = size.x,
+      .height = size.y,
+      .sphere_count = static_cast<uint32_t>(scene.spheres().size()),
+      .plane_count = static_cast<uint32_t>(scene.planes().size()),
+  };
+  auto configBuffer =
+      create_uniform_buffer(device, "Config Buffer", &config, sizeof(config));
+  auto configBindGroup = create_bind_group(device, "Config Bind Group",
+                                           config_layout, {configBuffer});
+
+  auto renderStart = std::chrono::steady_clock::now();
+  glm::uvec2 workgroups = calculateWorkgroups(size);
+  uint32_t passesSinceCheckpoint = 0;
+  while (state.samples < settings.samples) {
+    config.samples_per_pixel = static_cast<uint32_t>(std::min<uint64_t>(
+        settings.samples_per_pass, settings.samples - state.samples));
+    config.pass_index = state.passes.back().next;
+    device.GetQueue().WriteBuffer(configBuffer, 0, &config, sizeof(config));
+
+    wgpu::CommandEncoderDescriptor encDesc{
+        .label = "Compute Encoder",
+    };
+    auto computeEncoder = device.CreateCommandEncoder(&encDesc);
+    {
+      wgpu::ComputePassDescriptor passDesc{
+          .label = "Compute Pass",
+      };
+      auto computePass = computeEncoder.BeginComputePass(&passDesc);
+      computePass.SetPipeline(pipeline);
+      computePass.SetBindGroup(0, accumulationBindGroup);
+      computePass.SetBindGroup(1, configBindGroup);
+      computePass.SetBindGroup(2, scene_bind_group);
+      computePass.DispatchWorkgroups(workgroups.x, workgroups.y);
+      computePass.End();
+    }
+    auto commands = computeEncoder.Finish();
+    device.GetQueue().Submit(1, &commands);
     device.Tick();
-    if (outputBuffer.GetMapState() == wgpu::BufferMapState::Mapped) {
-      paddedOutput =
-          static_cast<const uint8_t *>(outputBuffer.GetConstMappedRange());
-      complete = true;
+    check_device();
+
+    state.samples += config.samples_per_pixel;
+    state.passes.back().next++;
+    if (settings.on_checkpoint && settings.checkpoint_every > 0 &&
+        ++passesSinceCheckpoint == settings.checkpoint_every &&
+        state.samples < settings.samples) {
+      settings.on_checkpoint(read_checkpoint(accumulation, state));
+      passesSinceCheckpoint = 0;
     }
   }
+  if (settings.on_checkpoint) {
+    settings.on_checkpoint(read_checkpoint(accumulation, state));
+  }
+
+  const auto &post = settings.post;
+  ResolveConfig resolveConfig{
+      .width = size.x,
+      .height = size.y,
+      .samples = static_cast<float>(state.samples),
+      .exposure = std::exp2(post.exposure),
+      .tonemap = post.tonemap,
+      .srgb = post.srgb,
+      .dither = post.dither,
+      .format = post.format,
+  };
+  auto resolveConfigBuffer =
+      create_uniform_buffer(device, "Resolve Config Buffer", &resolveConfig,
+                            sizeof(resolveConfig));
 
-  std::vector<uint8_t> output;
-  output.reserve(size.x * size.y * 4);
-  for (size_t y = 0; y < size.y; y++) {
-    auto start = &paddedOutput[bytesPerRow * y];
-    output.insert(output.end(), start, start + (size.x * 4));
+  // the resolve pass writes tightly packed rows to a storage buffer, which
+  // avoids the 256 byte row alignment of texture to buffer copies and only
+  // reads back the channels the output format keeps
+  auto resolveOutput = resolve_output(post.format, pixels);
+  const uint64_t outputSize = resolveOutput.words * sizeof(uint32_t);
+  wgpu::BufferDescriptor outputStorageDesc{
+      .label = "Output Storage Buffer",
+      .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc,
+      .size = outputSize,
+  };
+  auto outputStorage = device.CreateBuffer(&outputStorageDesc);
+  auto resolveBindGroup =
+      create_bind_group(device, "Resolve Bind Group", resolve_layout,
+                        {accumulation, outputStorage, resolveConfigBuffer});
+
+  wgpu::BufferDescriptor outputBufferDesc{
+      .label = "Output Buffer",
+      .usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::MapRead,
+      .size = outputSize,
+  };
+  auto outputBuffer = device.CreateBuffer(&outputBufferDesc);
+
+  wgpu::CommandEncoderDescriptor encDesc{
+      .label = "Resolve Encoder",
+  };
+  auto resolveEncoder = device.CreateCommandEncoder(&encDesc);
+  {
+    wgpu::ComputePassDescriptor passDesc{
+        .label = "Resolve Pass",
+    };
+    auto resolvePass = resolveEncoder.BeginComputePass(&passDesc);
+    resolvePass.SetPipeline(resolve_pipeline);
+    resolvePass.SetBindGroup(0, resolveBindGroup);
+    auto resolveWorkgroups = calculateResolveWorkgroups(resolveOutput.invocations);
+    resolvePass.DispatchWorkgroups(resolveWorkgroups.x, resolveWorkgroups.y);
+    resolvePass.End();
   }
-  return output;
+  resolveEncoder.CopyBufferToBuffer(outputStorage, 0, outputBuffer, 0,
+                                    outputSize);
+  auto commands = resolveEncoder.Finish();
+  device.GetQueue().Submit(1, &commands);
+
+  std::cerr << "waiting on render..." << '\n';
+  wait_for_map(outputBuffer, outputSize);
+  stats.render = std::chrono::steady_clock::now() - renderStart;
+
+  ImageView view{
+      .data = static_cast<const uint8_t *>(
+          outputBuffer.GetConstMappedRange(0, outputSize)),
+      .width = size.x,
+      .height = size.y,
+      .stride = size_t{size.x} * pixel_format_bytes(post.format),
+      .format = post.format,
+  };
+  return MappedImage{std::move(outputBuffer), view};
 }
@@ -1,33 +1,133 @@
 #ifndef RENDER_H_
 #define RENDER_H_
 
+#include "checkpoint.hpp"
+#include "output.hpp"
 #include "scene.hpp"
 
 #include <glm/vec2.hpp>
 #include <webgpu/webgpu_cpp.h>
 
+#include <array>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
-#include <vector>
+#include <unordered_map>
+
+// rendered image still living in the mapped readback buffer, which stays
+// mapped until this is destroyed so it can be encoded without a copy
+class MappedImage {
+public:
+  MappedImage(wgpu::Buffer buffer, ImageView view);
+  MappedImage(MappedImage &&) = default;
+  MappedImage &operator=(MappedImage &&) = default;
+  ~MappedImage();
+
+  const ImageView &view() const;
+
+private:
+  wgpu::Buffer buffer;
+  ImageView image;
+};
+
+struct RenderStats {
+  // whether the last render needed a new pipeline or only new scene buffers
+  bool recompiled = false;
+  std::chrono::duration<double, std::milli> codegen{};
+  std::chrono::duration<double, std::milli> compile{};
+  std::chrono::duration<double, std::milli> upload{};
+  std::chrono::duration<double, std::milli> render{};
+};
+
+struct RenderSettings {
+  glm::uvec2 size;
+  // total samples per pixel, including any resumed from a checkpoint
+  uint32_t samples;
+  uint32_t max_depth;
+  // samples are taken in passes of this many, each its own dispatch
+  uint32_t samples_per_pass = 10;
+  // rng pass index to start from, lets separate processes render disjoint
+  // ranges of passes that can be merged afterwards
+  uint32_t first_pass = 0;
+  // passes between calls to on_checkpoint, 0 only checkpoints at the end
+  uint32_t checkpoint_every = 0;
+  std::function<void(const Checkpoint &)> on_checkpoint;
+  // applied by the resolve pass on the gpu, also decides the pixel format of
+  // the returned image
+  PostSettings post;
+  // compile only the code for the primitive and material types in the
+  // scene, off compiles every material type for comparison
+  bool specialize = true;
+};
+
+// errors reported by the device callbacks, checked (and thrown) by the
+// renderer instead of aborting so in progress work can be saved
+struct DeviceStatus {
+  std::string error;
+  bool lost = false;
+};
 
 class Renderer {
 public:
-  Renderer(std::string source);
+  // fallback_adapter asks for a cpu adapter (SwiftShader), for machines
+  // without a usable gpu
+  Renderer(std::string source, std::string resolve_source,
+           bool fallback_adapter = false);
 
   wgpu::AdapterProperties adapter_properties() const;
-  std::vector<uint8_t> render_scene(Scene scene, glm::uvec2 size,
-                                    uint32_t samples, uint32_t max_depth);
+  // pipelines are cached per shader variant (the scene's feature set) and
+  // only built the first time a variant is needed, otherwise just the scene
+  // arrays are uploaded. continues from resume when given
+  MappedImage render_scene(const Scene &scene, const RenderSettings &settings,
+                           const Checkpoint *resume = nullptr);
+  const RenderStats &last_stats() const;
 
 private:
   wgpu::Adapter
   request_adapter(const wgpu::RequestAdapterOptions &options) const;
   wgpu::Device setup_device(const wgpu::Adapter adapter) const;
+  void setup_layouts();
+  void setup_resolve_pipeline();
+  // ticks the device until buffer is mapped, throwing on device errors
+  void wait_for_map(wgpu::Buffer &buffer, uint64_t size);
+  void check_device();
+  Checkpoint read_checkpoint(const wgpu::Buffer &accumulation,
+                             const Checkpoint &state);
+  void update_pipeline(const SceneFeatures &features,
+                       const std::string &scene_source);
+  void update_scene(const Scene &scene);
+  // returns whether the buffer had to be recreated
+  bool upload_array(wgpu::Buffer &buffer, const char *label, const void *data,
+                    size_t bytes);
 
 private:
   std::string source;
+  std::string resolve_source;
   wgpu::Instance instance;
   wgpu::Adapter adapter;
+  // heap allocated so the callbacks' pointer to it stays valid
+  std::unique_ptr<DeviceStatus> status;
   wgpu::Device device;
+
+  wgpu::BindGroupLayout accumulation_layout;
+  wgpu::BindGroupLayout config_layout;
+  wgpu::BindGroupLayout scene_layout;
+  wgpu::PipelineLayout pipeline_layout;
+
+  // keyed by SceneFeatures::mask
+  std::unordered_map<uint32_t, wgpu::ComputePipeline> pipelines;
+  wgpu::ComputePipeline pipeline;
+  static constexpr uint32_t SCENE_BUFFER_COUNT = 7;
+  std::array<wgpu::Buffer, SCENE_BUFFER_COUNT> scene_buffers;
+  wgpu::BindGroup scene_bind_group;
+
+  wgpu::BindGroupLayout resolve_layout;
+  wgpu::ComputePipeline resolve_pipeline;
+
+  RenderStats stats;
 };
 
 #endif // !RENDER_H_
@@ -0,0 +1,102 @@
+#include "save.hpp"
+#include "scene_binary.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+class YamlWriter {
+public:
+  explicit YamlWriter(std::ofstream &file) : file{file} {}
+
+  YamlWriter &operator<<(const char *text) {
+    file << text;
+    return *this;
+  }
+
+  // shortest representation that parses back to the same float, so saving a
+  // loaded scene is lossless and the output only depends on the scene
+  YamlWriter &operator<<(float value) {
+    std::array<char, 32> buffer;
+    auto result =
+        std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    file.write(buffer.data(), result.ptr - buffer.data());
+    return *this;
+  }
+
+  YamlWriter &operator<<(glm::vec3 value) {
+    return *this << "[" << value.x << ", " << value.y << ", " << value.z
+                 << "]";
+  }
+
+  YamlWriter &material(uint32_t index) {
+    file << 'm' << index;
+    return *this;
+  }
+
+private:
+  std::ofstream &file;
+};
+} // namespace
+
+void save_scene_yaml(const std::string &path, const Scene &scene) {
+  std::ofstream file{path};
+  if (!file) {
+    throw std::runtime_error{"failed to open scene file: " + path};
+  }
+  YamlWriter yaml{file};
+
+  yaml << "---\nhittables:\n";
+  const auto &spheres = scene.spheres();
+  for (size_t i = 0; i < spheres.size(); i++) {
+    yaml << "  - sphere:\n      center: " << spheres.centers[i]
+         << "\n      radius: " << spheres.radii[i] << "\n      material: ";
+    yaml.material(spheres.materials[i]) << "\n";
+  }
+  const auto &planes = scene.planes();
+  for (size_t i = 0; i < planes.size(); i++) {
+    yaml << "  - plane:\n      point: " << planes.points[i]
+         << "\n      normal: " << planes.normals[i] << "\n      material: ";
+    yaml.material(planes.materials[i]) << "\n";
+  }
+
+  yaml << "materials:\n";
+  const auto &materials = scene.materials().materials();
+  for (uint32_t i = 0; i < materials.size(); i++) {
+    const auto &material = materials[i];
+    glm::vec3 albedo{material.data};
+    yaml << "  - ";
+    yaml.material(i) << ":\n";
+    switch (material.type) {
+    case MaterialType::Lambertian:
+      yaml << "      lambertian:\n        albedo: " << albedo << "\n";
+      break;
+    case MaterialType::Metal:
+      yaml << "      metal:\n        albedo: " << albedo
+           << "\n        fuzz: " << material.data.w << "\n";
+      break;
+    case MaterialType::Dielectric:
+      yaml << "      dielectric:\n        ir: " << material.data.w << "\n";
+      break;
+    }
+  }
+
+  if (!file) {
+    throw std::runtime_error{"failed to write scene file: " + path};
+  }
+}
+
+void save_scene(const std::string &path, const Scene &scene) {
+  if (is_binary_scene_path(path)) {
+    save_scene_binary(path, scene);
+  } else {
+    save_scene_yaml(path, scene);
+  }
+}
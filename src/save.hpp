@@ -0,0 +1,13 @@
+#ifndef SAVE_HPP_
+#define SAVE_HPP_
+
+#include "scene.hpp"
+
+#include <string>
+
+// writes the scene in the format load_scene reads, picked by extension like
+// load_scene does. materials in yaml are named after their table index
+void save_scene(const std::string &path, const Scene &scene);
+void save_scene_yaml(const std::string &path, const Scene &scene);
+
+#endif // !SAVE_HPP_
@@ -1,12 +1,34 @@
 #include "scene.hpp"
 #include "code.hpp"
 
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
+#include <vector>
 
-Scene::Scene() : Scene{{}} {}
+Scene::Scene() {}
 
-Scene::Scene(std::vector<std::unique_ptr<Hittable>> hittables)
-    : hittables{std::move(hittables)} {}
+uint32_t Scene::add_material(const Material &material) {
+  return material_table.add(material);
+}
+
+void Scene::add_sphere(glm::vec3 center, float radius, uint32_t material) {
+  sphere_store.add(center, radius, material);
+}
+
+void Scene::add_plane(glm::vec3 point, glm::vec3 normal, uint32_t material) {
+  plane_store.add(point, normal, material);
+}
+
+const MaterialTable &Scene::materials() const { return material_table; }
+
+const Spheres &Scene::spheres() const { return sphere_store; }
+
+Spheres &Scene::spheres() { return sphere_store; }
+
+const Planes &Scene::planes() const { return plane_store; }
+
+Planes &Scene::planes() { return plane_store; }
 
 // clang-format off
 constexpr std::string_view GENERATION_HEADER = CODE(
@@ -23,11 +45,107 @@ constexpr std::string_view GENERATION_FOOTER = CODE(
 );
 // clang-format on
 
-std::string Scene::generate() const {
-  std::string body{GENERATION_HEADER};
-  for (const auto &hittable : hittables) {
-    body += hittable->generate();
+SceneFeatures SceneFeatures::with_all_materials() const {
+  SceneFeatures features{*this};
+  features.lambertian = true;
+  features.metal = true;
+  features.dielectric = true;
+  return features;
+}
+
+uint32_t SceneFeatures::mask() const {
+  return uint32_t{spheres} | uint32_t{planes} << 1 |
+         uint32_t{lambertian} << 2 | uint32_t{metal} << 3 |
+         uint32_t{dielectric} << 4;
+}
+
+std::string SceneFeatures::defines() const {
+  std::string defines;
+  auto define = [&](bool enabled, const char *name) {
+    if (enabled) {
+      defines += "#define ";
+      defines += name;
+      defines += '\n';
+    }
+  };
+  define(spheres, "HAS_SPHERES");
+  define(planes, "HAS_PLANES");
+  define(lambertian, "HAS_LAMBERTIAN");
+  define(metal, "HAS_METAL");
+  define(dielectric, "HAS_DIELECTRIC");
+  // lets ray_color skip the material switch entirely
+  define(int{lambertian} + int{metal} + int{dielectric} == 1,
+         "SINGLE_MATERIAL");
+  return defines;
+}
+
+SceneFeatures Scene::features() const {
+  SceneFeatures features{
+      .spheres = sphere_store.size() > 0,
+      .planes = plane_store.size() > 0,
+  };
+  for (const auto &material : material_table.materials()) {
+    switch (material.type) {
+    case MaterialType::Lambertian:
+      features.lambertian = true;
+      break;
+    case MaterialType::Metal:
+      features.metal = true;
+      break;
+    case MaterialType::Dielectric:
+      features.dielectric = true;
+      break;
+    }
   }
+  return features;
+}
+
+std::string Scene::generate() const { return generate(features()); }
+
+std::string Scene::generate(const SceneFeatures &features) const {
+  std::string body = features.defines();
+  body += GENERATION_HEADER;
+  body += sphere_store.generate();
+  body += plane_store.generate();
 
   return body + std::string{GENERATION_FOOTER};
 }
+
+SceneChange diff_scenes(const Scene &previous, const Scene &next) {
+  if (previous.generate() != next.generate()) {
+    return SceneChange::Structure;
+  } else if (previous.materials() != next.materials() ||
+             previous.spheres() != next.spheres() ||
+             previous.planes() != next.planes()) {
+    return SceneChange::Parameters;
+  }
+  return SceneChange::None;
+}
+
+namespace {
+// FNV-1a
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+template <typename T>
+uint64_t hash_column(uint64_t hash, const std::vector<T> &column) {
+  auto bytes = reinterpret_cast<const uint8_t *>(column.data());
+  for (size_t i = 0; i < column.size() * sizeof(T); i++) {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+  // separates columns so moving an element between them changes the hash
+  return (hash ^ column.size()) * FNV_PRIME;
+}
+} // namespace
+
+uint64_t hash_scene(const Scene &scene) {
+  uint64_t hash = FNV_OFFSET;
+  hash = hash_column(hash, scene.materials().materials());
+  hash = hash_column(hash, scene.spheres().centers);
+  hash = hash_column(hash, scene.spheres().radii);
+  hash = hash_column(hash, scene.spheres().materials);
+  hash = hash_column(hash, scene.planes().points);
+  hash = hash_column(hash, scene.planes().normals);
+  hash = hash_column(hash, scene.planes().materials);
+  return hash;
+}
@@ -1,21 +1,78 @@
 #ifndef SCENE_H_
 #define SCENE_H_
 
-#include "hittables/hittable.hpp"
+#include "hittables/plane.hpp"
+#include "hittables/sphere.hpp"
+#include "materials/material.hpp"
 
-#include <memory>
+#include <glm/vec3.hpp>
+
+#include <cstdint>
 #include <string>
-#include <vector>
 
+enum class SceneChange {
+  None,
+  // same generated code, only values in the scene arrays differ, so the
+  // existing pipeline can be reused with updated buffers
+  Parameters,
+  // the generated code differs and needs a new pipeline
+  Structure,
+};
+
+// primitive and material types a scene uses. generated code defines a
+// HAS_<TYPE> for each, so compute.wgsl only compiles what the scene needs
+struct SceneFeatures {
+  bool spheres = false;
+  bool planes = false;
+  bool lambertian = false;
+  bool metal = false;
+  bool dielectric = false;
+
+  // with every material type, the generic variant
+  SceneFeatures with_all_materials() const;
+  // one bit per feature, identifies the shader variant
+  uint32_t mask() const;
+  // the #defines for compute.wgsl
+  std::string defines() const;
+
+  bool operator==(const SceneFeatures &) const = default;
+};
+
+// columnar scene store: one set of contiguous arrays per primitive type plus a
+// deduplicated material table that primitives index into
 class Scene {
 public:
   Scene();
-  Scene(std::vector<std::unique_ptr<Hittable>> hittables);
 
+  uint32_t add_material(const Material &material);
+  void add_sphere(glm::vec3 center, float radius, uint32_t material);
+  void add_plane(glm::vec3 point, glm::vec3 normal, uint32_t material);
+
+  const MaterialTable &materials() const;
+  const Spheres &spheres() const;
+  Spheres &spheres();
+  const Planes &planes() const;
+  Planes &planes();
+
+  // primitive types with at least one primitive and the types of every
+  // material in the table
+  SceneFeatures features() const;
+
+  // feature defines and hit_scene for the primitive types present in the
+  // scene, the values themselves are read from the scene buffers. features
+  // may add to features() (e.g. to compile every material) but not remove
   std::string generate() const;
+  std::string generate(const SceneFeatures &features) const;
 
 private:
-  std::vector<std::unique_ptr<Hittable>> hittables;
+  MaterialTable material_table;
+  Spheres sphere_store;
+  Planes plane_store;
 };
 
+SceneChange diff_scenes(const Scene &previous, const Scene &next);
+
+// fingerprint of the scene contents, used to check checkpoints belong to it
+uint64_t hash_scene(const Scene &scene);
+
 #endif // !SCENE_H_
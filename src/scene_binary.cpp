@@ -0,0 +1,123 @@
+#include "scene_binary.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr std::array<char, 4> SCENE_MAGIC{'T', 'G', 'S', 'C'};
+constexpr uint32_t SCENE_VERSION = 1;
+
+template <typename T> void write_value(std::ofstream &file, const T &value) {
+  file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> T read_value(std::ifstream &file) {
+  T value;
+  file.read(reinterpret_cast<char *>(&value), sizeof(T));
+  return value;
+}
+
+template <typename T>
+void write_column(std::ofstream &file, const std::vector<T> &column) {
+  file.write(reinterpret_cast<const char *>(column.data()),
+             column.size() * sizeof(T));
+}
+
+template <typename T>
+void read_column(std::ifstream &file, std::vector<T> &column, uint64_t count) {
+  column.resize(count);
+  file.read(reinterpret_cast<char *>(column.data()), count * sizeof(T));
+}
+} // namespace
+
+void save_scene_binary(const std::string &path, const Scene &scene) {
+  std::ofstream file{path, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error{"failed to open scene file: " + path};
+  }
+
+  const auto &materials = scene.materials().materials();
+  const auto &spheres = scene.spheres();
+  const auto &planes = scene.planes();
+
+  file.write(SCENE_MAGIC.data(), SCENE_MAGIC.size());
+  write_value(file, SCENE_VERSION);
+  write_value(file, uint64_t{materials.size()});
+  write_value(file, uint64_t{spheres.size()});
+  write_value(file, uint64_t{planes.size()});
+  write_column(file, materials);
+  write_column(file, spheres.centers);
+  write_column(file, spheres.radii);
+  write_column(file, spheres.materials);
+  write_column(file, planes.points);
+  write_column(file, planes.normals);
+  write_column(file, planes.materials);
+  if (!file) {
+    throw std::runtime_error{"failed to write scene file: " + path};
+  }
+}
+
+Scene load_scene_binary(const std::string &path) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error{"failed to open scene file: " + path};
+  }
+
+  std::array<char, 4> magic;
+  file.read(magic.data(), magic.size());
+  if (magic != SCENE_MAGIC || read_value<uint32_t>(file) != SCENE_VERSION) {
+    throw std::runtime_error{"not a binary scene file: " + path};
+  }
+
+  auto material_count = read_value<uint64_t>(file);
+  auto sphere_count = read_value<uint64_t>(file);
+  auto plane_count = read_value<uint64_t>(file);
+  if (!file) {
+    throw std::runtime_error{"truncated scene file: " + path};
+  }
+
+  Scene scene;
+  std::vector<Material> materials;
+  read_column(file, materials, material_count);
+  auto &spheres = scene.spheres();
+  read_column(file, spheres.centers, sphere_count);
+  read_column(file, spheres.radii, sphere_count);
+  read_column(file, spheres.materials, sphere_count);
+  auto &planes = scene.planes();
+  read_column(file, planes.points, plane_count);
+  read_column(file, planes.normals, plane_count);
+  read_column(file, planes.materials, plane_count);
+  if (!file) {
+    throw std::runtime_error{"truncated scene file: " + path};
+  }
+
+  // the table was deduplicated when saved, so indices come back unchanged
+  for (const auto &material : materials) {
+    scene.add_material(material);
+  }
+  if (scene.materials().size() != material_count) {
+    throw std::runtime_error{"duplicate materials in scene file: " + path};
+  }
+  auto check_indices = [&](const std::vector<uint32_t> &indices) {
+    for (auto index : indices) {
+      if (index >= material_count) {
+        throw std::runtime_error{"material index out of range in scene file: " +
+                                 path};
+      }
+    }
+  };
+  check_indices(spheres.materials);
+  check_indices(planes.materials);
+  return scene;
+}
+
+bool is_binary_scene_path(const std::string &path) {
+  return std::filesystem::path{path}.extension() == ".tgs";
+}
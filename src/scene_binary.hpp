@@ -0,0 +1,16 @@
+#ifndef SCENE_BINARY_HPP_
+#define SCENE_BINARY_HPP_
+
+#include "scene.hpp"
+
+#include <string>
+
+// .tgs scenes are the scene columns written out as is, so loading one is a
+// handful of reads instead of parsing yaml, which matters past ~100k objects.
+// the layout is native endian and only meant for the machine that wrote it
+void save_scene_binary(const std::string &path, const Scene &scene);
+Scene load_scene_binary(const std::string &path);
+
+bool is_binary_scene_path(const std::string &path);
+
+#endif // !SCENE_BINARY_HPP_
@@ -0,0 +1,79 @@
+#include "procedural.hpp"
+#include "save.hpp"
+
+#include <cxxopts.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+  using Milliseconds = std::chrono::duration<double, std::milli>;
+
+  cxxopts::Options options(
+      "traceg-scenegen",
+      "Generates large scenes for stress testing and benchmarks, the same "
+      "seed and settings always give the same scene");
+  // clang-format off
+  options.add_options()
+    ("outputs", "Scene files to write, .tgs for the binary format and yaml otherwise",
+     cxxopts::value<std::vector<std::string>>())
+    ("n,count", "Number of spheres", cxxopts::value<uint32_t>()->default_value("1000"))
+    ("d,distribution", "uniform, clustered or nested (glass shells around a core)",
+     cxxopts::value<std::string>()->default_value("uniform"))
+    ("m,mix", "Material weights, e.g. lambertian=0.6,metal=0.3,dielectric=0.1",
+     cxxopts::value<std::string>()->default_value("lambertian=0.6,metal=0.3,dielectric=0.1"))
+    ("overlap", "0 keeps spheres apart, 1 makes neighbours intersect",
+     cxxopts::value<float>()->default_value("0"))
+    ("palette", "Distinct materials per material type",
+     cxxopts::value<uint32_t>()->default_value("16"))
+    ("seed", "Random seed", cxxopts::value<uint64_t>()->default_value("1"))
+    ("h,help", "Print usage")
+    ;
+  // clang-format on
+  options.parse_positional({"outputs"});
+  options.positional_help("<OUTPUT>...").show_positional_help();
+
+  auto result = options.parse(argc, argv);
+
+  if (result.count("help") > 0 || result.count("outputs") == 0) {
+    std::cerr << options.help() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  try {
+    ProceduralSettings settings{
+        .count = result["count"].as<uint32_t>(),
+        .distribution =
+            distribution_from_name(result["distribution"].as<std::string>()),
+        .mix = material_mix_from_string(result["mix"].as<std::string>()),
+        .overlap = result["overlap"].as<float>(),
+        .palette = result["palette"].as<uint32_t>(),
+        .seed = result["seed"].as<uint64_t>(),
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    Scene scene = procedural_scene(settings);
+    Milliseconds generate = std::chrono::steady_clock::now() - start;
+    std::cerr << "generated " << scene.spheres().size() << " spheres, "
+              << scene.materials().size() << " materials in "
+              << generate.count() << "ms" << '\n';
+
+    for (const auto &path :
+         result["outputs"].as<std::vector<std::string>>()) {
+      start = std::chrono::steady_clock::now();
+      save_scene(path, scene);
+      Milliseconds save = std::chrono::steady_clock::now() - start;
+      std::cerr << "wrote " << path << " in " << save.count() << "ms" << '\n';
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "scene generation failed: " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
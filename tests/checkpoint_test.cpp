@@ -0,0 +1,144 @@
+// merges small synthetic checkpoints and checks the pass ranges and sums,
+// and that checkpoints survive a save and load
+//
+// see tests/CMakeLists.txt for how the test is registered
+
+#include "checkpoint.hpp"
+
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+constexpr uint32_t WIDTH = 3;
+constexpr uint32_t HEIGHT = 2;
+
+// every pixel holds the same per-sample value times the samples taken
+Checkpoint make_checkpoint(std::vector<PassRange> passes, uint64_t samples,
+                           float value) {
+  return Checkpoint{
+      .width = WIDTH,
+      .height = HEIGHT,
+      .max_depth = 10,
+      .scene_hash = 42,
+      .passes = std::move(passes),
+      .samples = samples,
+      .accumulation = std::vector<glm::vec4>(
+          WIDTH * HEIGHT, glm::vec4{value * static_cast<float>(samples)}),
+  };
+}
+
+bool check(bool condition, const std::string &message) {
+  if (!condition) {
+    std::cerr << "FAIL: " << message << '\n';
+  }
+  return condition;
+}
+
+bool throws(const std::function<void()> &f) {
+  try {
+    f();
+  } catch (const std::exception &) {
+    return true;
+  }
+  return false;
+}
+
+bool test_sums() {
+  auto merged = merge_checkpoints({make_checkpoint({{0, 4}}, 40, 0.25f),
+                                   make_checkpoint({{4, 5}}, 10, 0.5f)});
+  bool passed = true;
+  passed &= check(merged.samples == 50, "samples aren't summed");
+  passed &= check(merged.passes == std::vector<PassRange>{{0, 5}},
+                  "adjacent ranges aren't joined");
+  for (const auto &pixel : merged.accumulation) {
+    passed &= check(pixel == glm::vec4{15.0f}, "accumulation isn't summed");
+  }
+  // 40 samples of 0.25 and 10 of 0.5 average to 0.3, 77 in 8 bits
+  auto pixels = resolve_checkpoint(merged);
+  passed &= check(pixels.size() == WIDTH * HEIGHT * 3 && pixels[0] == 77,
+                  "merged checkpoint doesn't resolve to the average");
+  return passed;
+}
+
+bool test_gaps() {
+  // passes 4 to 9 rendered later still merge in, in any order
+  auto merged = merge_checkpoints({make_checkpoint({{10, 12}}, 20, 1.0f),
+                                   make_checkpoint({{0, 4}}, 40, 1.0f)});
+  bool passed = true;
+  passed &= check(merged.passes == std::vector<PassRange>{{0, 4}, {10, 12}},
+                  "gap between ranges isn't kept");
+  auto filled =
+      merge_checkpoints({merged, make_checkpoint({{4, 10}}, 60, 1.0f)});
+  passed &= check(filled.passes == std::vector<PassRange>{{0, 12}},
+                  "filling a gap doesn't join the ranges");
+  passed &= check(filled.samples == 120, "samples aren't summed");
+  return passed;
+}
+
+bool test_rejects() {
+  bool passed = true;
+  passed &= check(throws([] {
+                    merge_checkpoints({make_checkpoint({{0, 4}}, 40, 1.0f),
+                                       make_checkpoint({{3, 6}}, 30, 1.0f)});
+                  }),
+                  "overlapping ranges are merged");
+  passed &= check(throws([] {
+                    merge_checkpoints(
+                        {make_checkpoint({{0, 2}, {8, 10}}, 40, 1.0f),
+                         make_checkpoint({{4, 9}}, 50, 1.0f)});
+                  }),
+                  "range overlapping a later range is merged");
+  passed &= check(throws([] {
+                    auto other = make_checkpoint({{4, 5}}, 10, 1.0f);
+                    other.scene_hash = 7;
+                    merge_checkpoints(
+                        {make_checkpoint({{0, 4}}, 40, 1.0f), other});
+                  }),
+                  "checkpoints of different scenes are merged");
+  passed &= check(throws([] { merge_checkpoints({}); }),
+                  "nothing is merged into something");
+  return passed;
+}
+
+bool test_save_load(const std::string &directory) {
+  auto checkpoint = make_checkpoint({{0, 4}, {10, 12}}, 60, 0.5f);
+  auto path = (std::filesystem::path{directory} / "test.ckpt").string();
+  std::filesystem::create_directories(directory);
+  save_checkpoint(path, checkpoint);
+  auto loaded = load_checkpoint(path);
+  return check(loaded.width == checkpoint.width &&
+                   loaded.height == checkpoint.height &&
+                   loaded.max_depth == checkpoint.max_depth &&
+                   loaded.scene_hash == checkpoint.scene_hash &&
+                   loaded.passes == checkpoint.passes &&
+                   loaded.samples == checkpoint.samples &&
+                   loaded.accumulation == checkpoint.accumulation,
+               "checkpoint changes in a save and load");
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::cerr << "usage: checkpoint-test <scratch directory>" << '\n';
+    return EXIT_FAILURE;
+  }
+
+  try {
+    bool passed = true;
+    passed &= test_sums();
+    passed &= test_gaps();
+    passed &= test_rejects();
+    passed &= test_save_load(argv[1]);
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (const std::exception &e) {
+    std::cerr << "FAIL: " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}
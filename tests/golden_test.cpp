@@ -0,0 +1,322 @@
+// renders a scene with the host tracer (or checks an image rendered
+// elsewhere, along with its traceg --stats timings), compares it against a
+// golden image and checks how long each stage took against a stored baseline
+//
+// see tests/CMakeLists.txt for how the tests are registered
+
+#include "checkpoint.hpp"
+#include "host_tracer.hpp"
+#include "load.hpp"
+#include "output.hpp"
+
+#include <cxxopts.hpp>
+#include <glm/vec2.hpp>
+#include <stb_image.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+class StageTimer {
+public:
+  template <typename F> auto time(const std::string &stage, F &&f) {
+    auto start = std::chrono::steady_clock::now();
+    if constexpr (std::is_void_v<decltype(f())>) {
+      f();
+      stages[stage] = std::chrono::steady_clock::now() - start;
+    } else {
+      auto result = f();
+      stages[stage] = std::chrono::steady_clock::now() - start;
+      return result;
+    }
+  }
+
+  std::map<std::string, Milliseconds> stages;
+};
+
+glm::uvec2 parse_dims(const std::string &dims_str) {
+  auto x_loc = dims_str.find("x");
+  auto width = std::stoi(dims_str.substr(0, x_loc));
+  auto height = std::stoi(dims_str.substr(x_loc + 1));
+  return {width, height};
+}
+
+struct LoadedImage {
+  uint32_t width;
+  uint32_t height;
+  std::vector<uint8_t> pixels;
+};
+
+LoadedImage load_image(const std::string &path) {
+  int width, height, channels;
+  uint8_t *data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+  if (!data) {
+    throw std::runtime_error{"failed to load image: " + path};
+  }
+  LoadedImage image{
+      .width = static_cast<uint32_t>(width),
+      .height = static_cast<uint32_t>(height),
+      .pixels = {data, data + size_t(width) * height * 4},
+  };
+  stbi_image_free(data);
+  return image;
+}
+
+// root mean square error over the rgb channels, in 8 bit units
+double rmse(const LoadedImage &a, const LoadedImage &b) {
+  if (a.width != b.width || a.height != b.height) {
+    throw std::runtime_error{"image dimensions differ from the golden image"};
+  }
+  double sum = 0.0;
+  for (size_t i = 0; i < a.pixels.size(); i += 4) {
+    for (size_t c = 0; c < 3; c++) {
+      double diff = double(a.pixels[i + c]) - double(b.pixels[i + c]);
+      sum += diff * diff;
+    }
+  }
+  return std::sqrt(sum / (double(a.width) * a.height * 3));
+}
+
+// stage timings from the last row of a traceg --stats csv, every column
+// named <stage>_ms
+std::map<std::string, Milliseconds> load_stats(const std::string &path) {
+  std::ifstream file{path};
+  if (!file) {
+    throw std::runtime_error{"failed to open stats file: " + path};
+  }
+  std::string header, line, row;
+  std::getline(file, header);
+  while (std::getline(file, line)) {
+    if (!line.empty()) {
+      row = line;
+    }
+  }
+  if (row.empty()) {
+    throw std::runtime_error{"no timings in stats file: " + path};
+  }
+
+  auto split = [](const std::string &text) {
+    std::vector<std::string> fields;
+    std::stringstream stream{text};
+    std::string field;
+    while (std::getline(stream, field, ',')) {
+      fields.push_back(field);
+    }
+    return fields;
+  };
+  auto names = split(header);
+  auto values = split(row);
+  constexpr std::string_view SUFFIX = "_ms";
+  std::map<std::string, Milliseconds> stages;
+  for (size_t i = 0; i < names.size() && i < values.size(); i++) {
+    if (names[i].ends_with(SUFFIX)) {
+      stages[names[i].substr(0, names[i].size() - SUFFIX.size())] =
+          Milliseconds{std::stod(values[i])};
+    }
+  }
+  return stages;
+}
+
+// baselines are plain "stage milliseconds" lines
+std::map<std::string, double> load_baseline(const std::string &path) {
+  std::map<std::string, double> baseline;
+  std::ifstream file{path};
+  std::string stage;
+  double ms;
+  while (file >> stage >> ms) {
+    baseline[stage] = ms;
+  }
+  return baseline;
+}
+
+void save_baseline(const std::string &path, const StageTimer &timer) {
+  std::filesystem::create_directories(
+      std::filesystem::path{path}.parent_path());
+  std::ofstream file{path};
+  for (const auto &[stage, ms] : timer.stages) {
+    file << stage << ' ' << ms.count() << '\n';
+  }
+}
+
+void write_report(const std::string &path, const std::string &name,
+                  double error, double tolerance, const StageTimer &timer,
+                  const std::map<std::string, double> &baseline,
+                  bool passed) {
+  std::filesystem::create_directories(
+      std::filesystem::path{path}.parent_path());
+  std::ofstream file{path};
+  file << "{\n"
+       << "  \"name\": \"" << name << "\",\n"
+       << "  \"passed\": " << (passed ? "true" : "false") << ",\n"
+       << "  \"rmse\": " << error << ",\n"
+       << "  \"tolerance\": " << tolerance << ",\n"
+       << "  \"stages\": {";
+  const char *separator = "\n";
+  for (const auto &[stage, ms] : timer.stages) {
+    file << separator << "    \"" << stage << "\": {\"ms\": " << ms.count();
+    if (auto it = baseline.find(stage); it != baseline.end()) {
+      file << ", \"baseline_ms\": " << it->second;
+    }
+    file << "}";
+    separator = ",\n";
+  }
+  file << "\n  }\n}\n";
+}
+
+int main(int argc, char **argv) {
+  cxxopts::Options options("golden-test",
+                           "Golden image and timing regression check");
+  // clang-format off
+  options.add_options()
+    ("name", "Test name used in the report", cxxopts::value<std::string>())
+    ("scene", "Scene to render with the host tracer", cxxopts::value<std::string>())
+    ("image", "Check an already rendered image instead of rendering", cxxopts::value<std::string>())
+    ("stats", "Stage timings of the already rendered image, from traceg --stats",
+     cxxopts::value<std::string>())
+    ("golden", "Golden image", cxxopts::value<std::string>())
+    ("output", "Where to write the rendered image", cxxopts::value<std::string>())
+    ("dims", "Dimensions in format WxH", cxxopts::value<std::string>()->default_value("96x64"))
+    ("samples", "Samples per pixel", cxxopts::value<uint32_t>()->default_value("32"))
+    ("depth", "Max ray depth", cxxopts::value<uint32_t>()->default_value("10"))
+    ("threads", "Host tracer threads (0 for all)", cxxopts::value<unsigned>()->default_value("1"))
+    ("tolerance", "Max RMSE against the golden image in 8 bit units",
+     cxxopts::value<double>()->default_value("2.0"))
+    ("baseline", "Stage timing baseline, recorded when missing", cxxopts::value<std::string>())
+    ("require-baseline", "Fail instead of recording a baseline when it's missing")
+    ("threshold", "Fail when a stage takes this many times its baseline (0 disables)",
+     cxxopts::value<double>()->default_value("1.5"))
+    ("slack", "Milliseconds a stage may always regress by, to ignore noise in tiny stages",
+     cxxopts::value<double>()->default_value("5"))
+    ("report", "Where to write the json report", cxxopts::value<std::string>())
+    ("update", "Overwrite the golden image and baseline instead of checking them")
+    ;
+  // clang-format on
+  auto result = options.parse(argc, argv);
+  if (result.count("name") == 0 || result.count("golden") == 0 ||
+      (result.count("scene") == 0 && result.count("image") == 0) ||
+      (result.count("scene") > 0 && result.count("output") == 0)) {
+    std::cerr << options.help() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  auto name = result["name"].as<std::string>();
+  auto golden_file = result["golden"].as<std::string>();
+  auto tolerance = result["tolerance"].as<double>();
+  bool update = result.count("update") > 0;
+
+  try {
+    StageTimer timer;
+    std::string image_file;
+    if (result.count("scene") > 0) {
+      image_file = result["output"].as<std::string>();
+      std::filesystem::create_directories(
+          std::filesystem::path{image_file}.parent_path());
+      HostSettings settings{
+          .size = parse_dims(result["dims"].as<std::string>()),
+          .samples = result["samples"].as<uint32_t>(),
+          .max_depth = result["depth"].as<uint32_t>(),
+          .threads = result["threads"].as<unsigned>(),
+      };
+
+      auto scene = timer.time("load", [&]() {
+        return load_scene(result["scene"].as<std::string>());
+      });
+      auto checkpoint = timer.time(
+          "trace", [&]() { return trace_scene_host(scene, settings); });
+      auto pixels = timer.time(
+          "resolve", [&]() { return resolve_checkpoint(checkpoint); });
+      timer.time("encode", [&]() {
+        ImageView view{
+            .data = pixels.data(),
+            .width = checkpoint.width,
+            .height = checkpoint.height,
+            .stride = size_t{checkpoint.width} * 3,
+            .format = PixelFormat::RGB8,
+        };
+        write_image(image_file, view, ImageFormat::PNG);
+      });
+    } else {
+      image_file = result["image"].as<std::string>();
+      if (result.count("stats") > 0) {
+        timer.stages = load_stats(result["stats"].as<std::string>());
+      }
+    }
+
+    if (update) {
+      std::filesystem::copy_file(
+          image_file, golden_file,
+          std::filesystem::copy_options::overwrite_existing);
+      std::cerr << "updated golden image " << golden_file << '\n';
+    }
+
+    bool passed = true;
+    double error = rmse(load_image(image_file), load_image(golden_file));
+    std::cerr << name << ": rmse " << error << " (tolerance " << tolerance
+              << ")" << '\n';
+    if (error > tolerance) {
+      std::cerr << "FAIL: image differs from " << golden_file << '\n';
+      passed = false;
+    }
+
+    std::map<std::string, double> baseline;
+    if (result.count("baseline") > 0 && !timer.stages.empty()) {
+      auto baseline_file = result["baseline"].as<std::string>();
+      auto threshold = result["threshold"].as<double>();
+      auto slack = result["slack"].as<double>();
+      if (update) {
+        save_baseline(baseline_file, timer);
+        std::cerr << "updated timing baseline " << baseline_file << '\n';
+      } else if (!std::filesystem::exists(baseline_file)) {
+        if (result.count("require-baseline") > 0) {
+          std::cerr << "FAIL: no timing baseline at " << baseline_file << '\n';
+          passed = false;
+        } else {
+          save_baseline(baseline_file, timer);
+          std::cerr << "WARNING: no timing baseline at " << baseline_file
+                    << ", recorded this run's timings without checking them"
+                    << '\n';
+        }
+      } else {
+        baseline = load_baseline(baseline_file);
+      }
+
+      for (const auto &[stage, ms] : timer.stages) {
+        auto it = baseline.find(stage);
+        if (it == baseline.end()) {
+          continue;
+        }
+        std::cerr << "  " << stage << ": " << ms.count() << "ms (baseline "
+                  << it->second << "ms)" << '\n';
+        if (threshold > 0.0 && ms.count() > it->second * threshold &&
+            ms.count() - it->second > slack) {
+          std::cerr << "FAIL: " << stage << " regressed past " << threshold
+                    << "x its baseline" << '\n';
+          passed = false;
+        }
+      }
+    }
+
+    if (result.count("report") > 0) {
+      write_report(result["report"].as<std::string>(), name, error, tolerance,
+                   timer, baseline, passed);
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (const std::exception &e) {
+    std::cerr << "FAIL: " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,224 @@
+// builds the compute shader the way Renderer::update_pipeline does for every
+// combination of scene features and checks each variant still declares
+// everything it refers to. there's no wgsl compiler to hand without a gpu, so
+// this is a textual check: every use of a name that compute.wgsl or the
+// generated code declares at module scope must have a surviving declaration
+//
+// see tests/CMakeLists.txt for how the test is registered
+
+#include "preprocess.hpp"
+#include "scene.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+constexpr uint32_t FEATURE_COUNT = 5;
+
+std::string read_file(const std::string &path) {
+  std::ifstream file{path};
+  if (!file) {
+    throw std::runtime_error{"failed to open " + path};
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+// names declared at module scope (by fn, struct, alias, const and var) and
+// every other name used, member accesses aside. preprocessor lines are
+// skipped, so run on unprocessed source this sees every branch
+struct Names {
+  std::set<std::string> declared;
+  std::set<std::string> used;
+};
+
+Names scan(std::string_view source) {
+  Names names;
+  int depth = 0;
+  int template_depth = 0;
+  bool pending_declaration = false;
+  bool member_access = false;
+  bool line_start = true;
+
+  size_t i = 0;
+  while (i < source.size()) {
+    char c = source[i];
+    if (line_start && c == '#') {
+      i = source.find('\n', i);
+      continue;
+    }
+    if (c == '/' && i + 1 < source.size() && source[i + 1] == '/') {
+      i = source.find('\n', i);
+      continue;
+    }
+    if (c == '\n') {
+      line_start = true;
+      i++;
+      continue;
+    }
+    if (c == ' ' || c == '\t' || c == '\r') {
+      i++;
+      continue;
+    }
+    line_start = false;
+
+    if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+      size_t start = i;
+      while (i < source.size() &&
+             (std::isalnum(static_cast<unsigned char>(source[i])) ||
+              source[i] == '_')) {
+        i++;
+      }
+      std::string name{source.substr(start, i - start)};
+      if (template_depth > 0) {
+        // address space and access mode of a var
+        continue;
+      }
+      if (pending_declaration) {
+        names.declared.insert(name);
+        pending_declaration = false;
+      } else if (depth == 0 && (name == "fn" || name == "struct" ||
+                                name == "alias" || name == "const" ||
+                                name == "var")) {
+        pending_declaration = true;
+      } else if (!member_access) {
+        names.used.insert(name);
+      }
+      member_access = false;
+      continue;
+    }
+
+    if (pending_declaration && c == '<') {
+      template_depth++;
+    } else if (template_depth > 0 && c == '>') {
+      template_depth--;
+    } else if (c == '{') {
+      depth++;
+    } else if (c == '}') {
+      depth--;
+    }
+    member_access = c == '.';
+    if (std::isdigit(static_cast<unsigned char>(c))) {
+      // skip the rest of number literals so suffixes aren't taken as names
+      while (i < source.size() &&
+             (std::isalnum(static_cast<unsigned char>(source[i])) ||
+              source[i] == '.')) {
+        i++;
+      }
+      continue;
+    }
+    i++;
+  }
+  return names;
+}
+
+SceneFeatures features_from_mask(uint32_t mask) {
+  return SceneFeatures{
+      .spheres = (mask & 1) != 0,
+      .planes = (mask & 2) != 0,
+      .lambertian = (mask & 4) != 0,
+      .metal = (mask & 8) != 0,
+      .dielectric = (mask & 16) != 0,
+  };
+}
+
+// a scene with exactly the given features, primitives need a material so
+// there's no such scene when there are primitives but no materials
+bool build_scene(const SceneFeatures &features, Scene &scene) {
+  if (features.lambertian) {
+    scene.add_material({.type = MaterialType::Lambertian,
+                        .data = {0.5f, 0.5f, 0.5f, 0.0f}});
+  }
+  if (features.metal) {
+    scene.add_material(
+        {.type = MaterialType::Metal, .data = {0.8f, 0.8f, 0.8f, 0.1f}});
+  }
+  if (features.dielectric) {
+    scene.add_material(
+        {.type = MaterialType::Dielectric, .data = {1.0f, 1.0f, 1.0f, 1.5f}});
+  }
+  if (scene.materials().size() == 0 && (features.spheres || features.planes)) {
+    return false;
+  }
+  if (features.spheres) {
+    scene.add_sphere({0.0f, 0.0f, -1.0f}, 0.5f, 0);
+  }
+  if (features.planes) {
+    scene.add_plane({0.0f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, 0);
+  }
+  return true;
+}
+
+// returns whether the variant is complete, printing what's missing
+bool check_variant(const std::string &label, const std::string &source,
+                   const std::set<std::string> &module_names) {
+  std::string processed;
+  try {
+    processed = preprocess(source);
+  } catch (const std::exception &e) {
+    std::cerr << "FAIL: " << label << ": " << e.what() << '\n';
+    return false;
+  }
+
+  auto names = scan(processed);
+  bool passed = true;
+  for (const auto &entry_point : {"main", "hit_scene"}) {
+    if (!names.declared.contains(entry_point)) {
+      std::cerr << "FAIL: " << label << ": no " << entry_point << '\n';
+      passed = false;
+    }
+  }
+  for (const auto &name : names.used) {
+    if (module_names.contains(name) && !names.declared.contains(name)) {
+      std::cerr << "FAIL: " << label << ": uses " << name
+                << " but doesn't declare it" << '\n';
+      passed = false;
+    }
+  }
+  return passed;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::cerr << "usage: shader-test <compute.wgsl>" << '\n';
+    return EXIT_FAILURE;
+  }
+
+  try {
+    auto source = read_file(argv[1]);
+
+    bool passed = true;
+    uint32_t variants = 0;
+    for (uint32_t mask = 0; mask < (1u << FEATURE_COUNT); mask++) {
+      Scene scene;
+      if (!build_scene(features_from_mask(mask), scene)) {
+        continue;
+      }
+      auto features = scene.features();
+      // specialized and generic, as chosen by --no-specialize
+      for (const auto &variant : {features, features.with_all_materials()}) {
+        auto full = scene.generate(variant) + source;
+        auto label = "variant " + std::to_string(variant.mask());
+        passed &= check_variant(label, full, scan(full).declared);
+        variants++;
+      }
+    }
+
+    std::cerr << "checked " << variants << " shader variants" << '\n';
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (const std::exception &e) {
+    std::cerr << "FAIL: " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}